@@ -9,10 +9,19 @@
 #include "src/GlobalAnalyzer.h"
 #include "src/UserAnalyzer.h"
 #include "src/Matcher.h"
+#include "src/Subnet6.h"
+#include "src/SubnetSet.h"
+#include "src/Utils.h"
+#include "src/Memory.h"
 #include <getopt.h>
 #include <filesystem>
 #include <chrono>
+#include <ctime>
 #include <iostream>
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <thread>
 #include "src/UserList.h"
 #include "src/TermColor.h"
 
@@ -21,7 +30,7 @@ using namespace std::chrono;
 
 void help()
 {
-	cout << "Usage: slanalyzer [-h] [-s SAFELIST|BLOCKLIST ] [-u USEREXPORT ] [-o OUTPUTFILE] [SMART_SEARCH_FILES...]"
+	cout << "Usage: slanalyzer [-h] [-s SAFELIST|BLOCKLIST ] [-u USEREXPORT ] [-o OUTPUTFILE] [-t THREADS] [SMART_SEARCH_FILES...]"
 		 << endl
 		 << endl
 		 << "Search multiple smart search exports to determine which safe or block list entries triggered against the mail flow."
@@ -40,6 +49,16 @@ void help()
 		 << endl
 		 << "-x, --extended        (optional) Only applies to user list exports provides full details of block and safe lists and field that matched"
 		 << endl
+		 << "-t, --threads         (optional) Number of analysis threads, defaults to the number of cores"
+		 << endl
+		 << "    --subnet-layout   (optional) Lookup layout of ip_in_net CIDRs: trie, dir-24-8 (large lists) or poptrie (default)"
+		 << endl
+		 << "    --domainsets      (optional) Directory holding the domain sets is_in_domainset entries name, one file per set (NAME or NAME.txt) with a domain per line"
+		 << endl
+		 << "    --regex-mem       (optional) Memory in MB each RE2 set of regex entries may use, larger lists are split into several sets (default 16)"
+		 << endl
+		 << "    --benchmark       (optional) Only applies to safe / block lists reports memory and lookups per second of each subnet layout"
+		 << endl
 		 << "-h, --help            show this help message and exit"
 		 << endl
 		 << endl
@@ -50,9 +69,209 @@ void help()
 		 << endl;
 }
 
+// Smart search bytes processed per second for a file analyzed in duration
+double throughput(const string& file, microseconds duration)
+{
+	if (duration.count() == 0)
+		return 0;
+	return (double)filesystem::file_size(file)/(double)duration.count()/1000;
+}
+
+// Process CPU time in seconds, summed over every thread
+double cpu_time()
+{
+	return (double)std::clock()/CLOCKS_PER_SEC;
+}
+
+// Time, memory and pattern count compiling each field took, one line per field. Memory is
+// only known in builds with SLANALYZER_TRACK_MEMORY, except for the domain sets whose index
+// reports its own size.
+void print_compile_stats(const Proofpoint::CompileStats& compile_stats)
+{
+	for (const auto& stat : compile_stats) {
+		if (!stat.patterns)
+			continue;
+		cout << std::right << std::setw(25) << (stat.name + " Compile: ")
+			 << std::left << std::fixed << std::setprecision(6) << stat.seconds << "s, ";
+		if (Proofpoint::Memory::tracked || stat.sized)
+			cout << std::setprecision(1) << (double)std::max<std::int64_t>(stat.memory, 0)/1024 << " KB, ";
+		cout << std::defaultfloat << stat.patterns << " patterns";
+		if (stat.demoted)
+			cout << ", " << stat.demoted << " regexes matched as literals";
+		cout << endl;
+	}
+}
+
+// RE2 sets the regex entries of each field were split into, with the memory each took to
+// compile when it's tracked, the Latin-1 copies of those sets, patterns matched on their own
+// and values a set ran out of DFA memory on
+void print_regex_stats(const Proofpoint::RegexStats& regex_stats)
+{
+	constexpr std::size_t MAX_LISTED_SETS = 8;
+	for (const auto& stat : regex_stats) {
+		if (stat.shard_memory.empty() && !stat.isolated)
+			continue;
+		cout << std::right << std::setw(25) << (stat.name + " Regex Sets: ")
+			 << std::left << stat.shard_memory.size();
+		if (Proofpoint::Memory::tracked) {
+			// Domain partitions make many small sets, those are only added up
+			if (stat.shard_memory.size()>MAX_LISTED_SETS) {
+				std::int64_t total = 0;
+				for (auto memory : stat.shard_memory)
+					total += std::max<std::int64_t>(memory, 0);
+				cout << " (" << std::fixed << std::setprecision(1) << (double)total/1024 << " KB total)";
+			}
+			else {
+				cout << " (";
+				for (std::size_t i = 0; i<stat.shard_memory.size(); i++)
+					cout << (i ? ", " : "") << std::fixed << std::setprecision(1)
+						 << (double)std::max<std::int64_t>(stat.shard_memory[i], 0)/1024 << " KB";
+				cout << ")";
+			}
+		}
+		if (!stat.latin1_shard_memory.empty()) {
+			cout << ", " << stat.latin1_shard_memory.size()
+				 << (stat.latin1_shard_memory.size()==1 ? " Latin-1 copy" : " Latin-1 copies");
+			if (Proofpoint::Memory::tracked) {
+				std::int64_t total = 0;
+				for (auto memory : stat.latin1_shard_memory)
+					total += std::max<std::int64_t>(memory, 0);
+				cout << " (" << std::fixed << std::setprecision(1) << (double)total/1024 << " KB)";
+			}
+		}
+		cout << std::defaultfloat << ", " << stat.isolated << " isolated, "
+			 << stat.fallbacks << " DFA fallbacks";
+		if (stat.partitions)
+			cout << ", " << stat.partitions << " domain partitions";
+		cout << endl;
+	}
+}
+
+// Memory and lookup rate of each subnet set layout over the CIDRs of the ip_in_net and
+// ip_not_in_net entries. A quarter of the addresses looked up are IPv6 and half of each
+// family fall inside a random CIDR of that family. The batched rate looks the IPv4 addresses
+// up in blocks the way the analyzer does and the IPv6 ones one at a time.
+void print_subnet_benchmark(const Proofpoint::GlobalList& safelist)
+{
+	std::vector<std::string> cidrs;
+	std::vector<Proofpoint::Subnet> subnets;
+	std::vector<Proofpoint::Subnet6> subnets6;
+	for (const auto& entry : safelist) {
+		if (entry.field_type!=Proofpoint::GlobalList::FieldType::IP ||
+			(entry.match_type!=Proofpoint::GlobalList::MatchType::IP_IN_NET &&
+			 entry.match_type!=Proofpoint::GlobalList::MatchType::IP_NOT_IN_NET))
+			continue;
+		for (const auto& cidr : Proofpoint::Utils::split(entry.pattern, ',')) {
+			try {
+				if (cidr.find(':')!=std::string_view::npos)
+					subnets6.emplace_back(std::string(cidr));
+				else
+					subnets.emplace_back(std::string(cidr));
+				cidrs.emplace_back(cidr);
+			}
+			catch (const std::exception&) {
+				// Reported as a pattern error by the analyzer
+			}
+		}
+	}
+
+	struct Address
+	{
+		bool v6;
+		uint32_t v4;
+		Proofpoint::Address6 address6;
+	};
+
+	std::mt19937_64 random(42);
+	std::vector<Address> addresses(1 << 20);
+	for (std::size_t i = 0; i<addresses.size(); i++) {
+		auto& address = addresses[i];
+		const bool inside = i%2;
+		address.v6 = (i/2)%4==0;
+		if (address.v6) {
+			address.address6 = {random(), random()};
+			if (inside && !subnets6.empty()) {
+				const auto& subnet = subnets6[random()%subnets6.size()];
+				const auto net = subnet.GetNetAddress();
+				const auto wildcard = subnet.GetWildcardAddress();
+				address.address6 = {net.hi | (address.address6.hi & wildcard.hi),
+									net.lo | (address.address6.lo & wildcard.lo)};
+			}
+		}
+		else {
+			address.v4 = static_cast<uint32_t>(random());
+			if (inside && !subnets.empty()) {
+				const auto& subnet = subnets[random()%subnets.size()];
+				address.v4 = subnet.GetNetAddress() | (address.v4 & subnet.GetWildcardAddress());
+			}
+		}
+	}
+
+	std::vector<uint32_t> addresses4;
+	std::vector<Proofpoint::Address6> addresses6;
+	for (const auto& address : addresses) {
+		if (address.v6)
+			addresses6.push_back(address.address6);
+		else
+			addresses4.push_back(address.v4);
+	}
+
+	cout << std::left << "### Subnet Benchmark ###" << endl
+		 << std::right << std::setw(25) << "CIDR Count: " << std::left
+		 << subnets.size() << " IPv4, " << subnets6.size() << " IPv6" << endl;
+	for (auto layout : {Proofpoint::SubnetSet::Layout::TRIE, Proofpoint::SubnetSet::Layout::DIR_24_8,
+						Proofpoint::SubnetSet::Layout::POPTRIE}) {
+		Proofpoint::SubnetSet subnet_set;
+		std::string error;
+		for (const auto& cidr : cidrs)
+			subnet_set.Add(cidr, &error);
+
+		auto s = high_resolution_clock::now();
+		subnet_set.Freeze(layout);
+		auto build = duration<double>(high_resolution_clock::now()-s).count();
+
+		const std::size_t rounds = 8;
+		std::vector<int> matches;
+		std::size_t matched = 0;
+		s = high_resolution_clock::now();
+		for (std::size_t round = 0; round<rounds; round++) {
+			for (const auto& address : addresses) {
+				if (address.v6)
+					subnet_set.Match(address.address6, &matches);
+				else
+					subnet_set.Match(address.v4, &matches);
+				matched += matches.size();
+			}
+		}
+		auto seconds = duration<double>(high_resolution_clock::now()-s).count();
+
+		const std::size_t block = Proofpoint::GlobalAddressMatcher::BATCH_SIZE;
+		std::vector<uint32_t> offsets;
+		s = high_resolution_clock::now();
+		for (std::size_t round = 0; round<rounds; round++) {
+			for (std::size_t i = 0; i<addresses4.size(); i += block) {
+				subnet_set.MatchBatch(std::span(addresses4).subspan(i, std::min(block, addresses4.size()-i)),
+									  offsets, matches);
+			}
+			for (const auto& address : addresses6)
+				subnet_set.Match(address, &matches);
+		}
+		auto batched = duration<double>(high_resolution_clock::now()-s).count();
+
+		cout << std::right << std::setw(25) << (Proofpoint::SubnetSet::GetLayoutString(layout) + ": ")
+			 << std::left << std::fixed << std::setprecision(1)
+			 << (double)subnet_set.MemoryUsage()/1024 << " KB, "
+			 << (double)(rounds*addresses.size())/seconds/1000000 << "M lookups/s, "
+			 << (double)(rounds*addresses.size())/batched/1000000 << "M batched lookups/s, "
+			 << std::setprecision(6) << build << "s build, "
+			 << std::defaultfloat << matched/rounds << " matches" << endl;
+	}
+	cout << endl;
+}
+
 void usage()
 {
-	cout << "Usage: slanalyzer [-h] [-s SAFELIST|BLOCKLIST ] [-u USEREXPORT ] [-o OUTPUTFILE] [SMART_SEARCH_FILES...]" << endl
+	cout << "Usage: slanalyzer [-h] [-s SAFELIST|BLOCKLIST ] [-u USEREXPORT ] [-o OUTPUTFILE] [-t THREADS] [SMART_SEARCH_FILES...]" << endl
 		 << "Try 'slanalyzer --help' for more information." << endl;
 }
 int main(int argc, char* argv[])
@@ -72,6 +291,11 @@ int main(int argc, char* argv[])
 	bool extended = false;
 	bool output = false;
 	bool files = false;
+	bool benchmark = false;
+	auto subnet_layout = Proofpoint::SubnetSet::Layout::POPTRIE;
+	string domain_set_path;
+	std::int64_t regex_mem = Proofpoint::Matcher<std::size_t>::DEFAULT_MAX_MEM;
+	std::size_t threads = std::max(1u, std::thread::hardware_concurrency());
 
 	static struct option long_options[] =
 			{
@@ -79,13 +303,18 @@ int main(int argc, char* argv[])
 					{("userlist"), required_argument, 0, 'u'},
 					{("extended"), required_argument, 0, 'x'},
 					{("output"), required_argument, 0, 'o'},
+					{("threads"), required_argument, 0, 't'},
+					{("subnet-layout"), required_argument, 0, 'l'},
+					{("domainsets"), required_argument, 0, 'd'},
+					{("regex-mem"), required_argument, 0, 'r'},
+					{("benchmark"), no_argument, 0, 'b'},
 					{("help"), no_argument, 0, 'h'},
 					{0, 0, 0, 0}
 			};
 
 	int option_index = 0;
 
-	while ((c = getopt_long(argc, argv, "s:u:xo:h", long_options, &option_index))!=-1) {
+	while ((c = getopt_long(argc, argv, "s:u:xo:t:h", long_options, &option_index))!=-1) {
 		switch (c) {
 		case 's': safe_list = optarg;
 			safe = true;
@@ -99,6 +328,44 @@ int main(int argc, char* argv[])
 		case 'o': output_list = optarg;
 			output = true;
 			break;
+		case 't':
+			try {
+				threads = std::stoul(optarg);
+			}
+			catch (const std::exception&) {
+				threads = 0;
+			}
+			if (threads==0) {
+				cerr << "Threads must be a positive number." << endl;
+				exit(1);
+			}
+			break;
+		case 'l':
+			if (auto layout = Proofpoint::SubnetSet::GetLayout(optarg)) {
+				subnet_layout = *layout;
+			}
+			else {
+				cerr << "Subnet layout must be one of trie, dir-24-8 or poptrie." << endl;
+				exit(1);
+			}
+			break;
+		case 'd': domain_set_path = optarg;
+			break;
+		case 'r':
+			try {
+				regex_mem = (std::int64_t)std::stoul(optarg)*1024*1024;
+			}
+			catch (const std::exception&) {
+				regex_mem = 0;
+			}
+			if (regex_mem==0) {
+				cerr << "Regex memory must be a positive number of MB." << endl;
+				exit(1);
+			}
+			break;
+		case 'b':
+			benchmark = true;
+			break;
 		case 'h': help();
 			exit(0);
 			break;
@@ -195,40 +462,84 @@ int main(int argc, char* argv[])
 
 		// Used to collect pattern errors in the even there is a bad pattern
 		Proofpoint::PatternErrors<std::size_t> pattern_errors;
-		Proofpoint::GlobalAnalyzer processor;
+		Proofpoint::CompileStats compile_stats;
+		Proofpoint::GlobalAnalyzer processor(subnet_layout,domain_set_path,regex_mem);
 
 
 		s = high_resolution_clock::now();
-		processor.Load(safelist,pattern_errors);
+		processor.Load(safelist,pattern_errors,compile_stats,threads);
 		e = high_resolution_clock::now();
 		d = duration_cast<microseconds>(e-s);
 		std::cout << std::left << "### Preprocessing Completed ###" << std::endl
 				  << std::right << std::setw(25) <<  "Load Time: "
 				  << std::left << std::setprecision(9) << (double)d.count()/1000000 << "s" << std::endl
 				  << std::right << std::setw(25) << "Pattern Errors: "
-				  << std::left << std::setw(25) << pattern_errors.size() << std::endl
-				  << std::endl;
-
-		for (const auto& file : ss_inputs) {
-			s = high_resolution_clock::now();
-			std::size_t records_processed = 0;
-			auto header_index = processor.Process(file, safelist, records_processed);
-			e = high_resolution_clock::now();
-			d = duration_cast<microseconds>(e-s);
-			total_records_processed += records_processed;
-			std::cout << std::left << "### Analysis Completed ###" << std::endl
-					  << std::right << std::setw(25) <<  "Analysis Time: "
-					  << std::left << std::setprecision(9) << (double)d.count()/1000000 << "s" << std::endl
-			          << std::right << std::setw(25) <<  "Records Processed: "
-			          << std::left << records_processed << std::endl
-					  << std::right << std::setw(25) << "Smart Search File: "
-					  << file << (!header_index ? " (No CSV Header Found)" : "") << std::endl << std::endl;
+				  << std::left << std::setw(25) << pattern_errors.size() << std::endl;
+		print_compile_stats(compile_stats);
+		std::cout << std::endl;
+
+		if (benchmark)
+			print_subnet_benchmark(safelist);
+
+		// Each worker takes whole files and counts into its own counters, threads left
+		// over when there are fewer files than threads split the files themselves
+		const std::size_t workers = std::min(threads, ss_inputs.size());
+		const std::size_t file_threads = std::max<std::size_t>(1, threads/workers);
+		std::vector<Proofpoint::GlobalList::Counters> counters(workers, safelist.MakeCounters());
+		std::atomic<std::size_t> next_file = 0;
+		std::mutex output_lock;
+
+		auto analysis_start = high_resolution_clock::now();
+		auto analysis_cpu = cpu_time();
+		{
+			std::vector<std::jthread> pool;
+			for (std::size_t worker = 0; worker<workers; worker++) {
+				pool.emplace_back([&, worker] {
+					for (std::size_t i = next_file++; i<ss_inputs.size(); i = next_file++) {
+						const auto& file = ss_inputs[i];
+						auto s = high_resolution_clock::now();
+						std::size_t records_processed = 0;
+						std::size_t row_allocations = 0;
+						auto header_index = processor.Process(file, counters[worker], records_processed, row_allocations, file_threads);
+						auto e = high_resolution_clock::now();
+						auto d = duration_cast<microseconds>(e-s);
+						std::lock_guard<std::mutex> lock(output_lock);
+						total_records_processed += records_processed;
+						std::cout << std::left << "### Analysis Completed ###" << std::endl
+								  << std::right << std::setw(25) <<  "Analysis Time: "
+								  << std::left << std::setprecision(9) << (double)d.count()/1000000 << "s" << std::endl
+								  << std::right << std::setw(25) <<  "Records Processed: "
+								  << std::left << records_processed << std::endl;
+						if (Proofpoint::Memory::tracked)
+							std::cout << std::right << std::setw(25) <<  "Row Allocations: "
+									  << std::left << row_allocations << std::endl;
+						std::cout << std::right << std::setw(25) <<  "Throughput: "
+								  << std::left << std::setprecision(3) << throughput(file, d) << " GB/s" << std::endl
+								  << std::right << std::setw(25) << "Smart Search File: "
+								  << file << (!header_index ? " (No CSV Header Found)" : "") << std::endl << std::endl;
+					}
+				});
+			}
 		}
+		auto analysis_wall = duration_cast<microseconds>(high_resolution_clock::now()-analysis_start);
+		analysis_cpu = cpu_time()-analysis_cpu;
+
+		for (const auto& c : counters)
+			safelist.Merge(c);
+
 		std::cout << std::left << "### Analysis Summary ###" << std::endl
 				  << std::right << std::setw(25) <<  "Total Inbound: "
 				  << std::left << safelist.GetInboundCount() << std::endl
 				  << std::right << std::setw(25) <<  "Total Outbound: "
-				  << std::left << safelist.GetOutboundCount() << std::endl << std::endl;
+				  << std::left << safelist.GetOutboundCount() << std::endl
+				  << std::right << std::setw(25) <<  "Threads: "
+				  << std::left << threads << std::endl
+				  << std::right << std::setw(25) <<  "Wall Clock Time: "
+				  << std::left << std::setprecision(9) << (double)analysis_wall.count()/1000000 << "s" << std::endl
+				  << std::right << std::setw(25) <<  "CPU Time: "
+				  << std::left << std::setprecision(9) << analysis_cpu << "s" << std::endl;
+		print_regex_stats(processor.GetRegexStats());
+		std::cout << std::endl;
 
 		s = high_resolution_clock::now();
 		safelist.Save(output_list);
@@ -281,40 +592,77 @@ int main(int argc, char* argv[])
 
 		// Used to collect pattern errors in the even there is a bad pattern
 		Proofpoint::PatternErrors<Proofpoint::UserAnalyzer::UserMatch> pattern_errors;
+		Proofpoint::CompileStats compile_stats;
 
 		Proofpoint::UserAnalyzer processor;
 
 		s = high_resolution_clock::now();
-		processor.Load(user_safe_list,pattern_errors);
+		processor.Load(user_safe_list,pattern_errors,compile_stats,threads);
 		e = high_resolution_clock::now();
 		d = duration_cast<microseconds>(e-s);
 		std::cout << std::left << "### Preprocessing Completed ###" << std::endl
 				  << std::right << std::setw(25) <<  "Load Time: "
 				  << std::left << std::setprecision(9) << (double)d.count()/1000000 << "s" << std::endl
 				  << std::right << std::setw(25) << "Pattern Errors: "
-				  << std::left << std::setw(25) << pattern_errors.size() << std::endl << std::endl;
-
-		for (const auto& file : ss_inputs)
+				  << std::left << std::setw(25) << pattern_errors.size() << std::endl;
+		print_compile_stats(compile_stats);
+		std::cout << std::endl;
+
+		// Each worker takes whole files and counts into its own counters
+		const std::size_t workers = std::min(threads, ss_inputs.size());
+		std::vector<Proofpoint::UserList::Counters> counters(workers, user_safe_list.MakeCounters());
+		std::atomic<std::size_t> next_file = 0;
+		std::mutex output_lock;
+
+		auto analysis_start = high_resolution_clock::now();
+		auto analysis_cpu = cpu_time();
 		{
-			s = high_resolution_clock::now();
-			std::size_t records_processed = 0;
-			auto header_index = processor.Process(file, user_safe_list, records_processed);
-			e = high_resolution_clock::now();
-			d = duration_cast<microseconds>(e-s);
-			total_records_processed += records_processed;
-			std::cout << std::left << "### Analysis Completed ###" << std::endl
-					  << std::right << std::setw(25) <<  "Analysis Time: "
-					  << std::left << std::setprecision(9) << (double)d.count()/1000000 << "s" << std::endl
-			          << std::right << std::setw(25) <<  "Records Processed: "
-                      << std::left << records_processed << std::endl
-					  << std::right << std::setw(25) << "Smart Search File: "
-					  << file << (!header_index ? " (No CSV Header Found)" : "") << std::endl << std::endl;
+			std::vector<std::jthread> pool;
+			for (std::size_t worker = 0; worker<workers; worker++) {
+				pool.emplace_back([&, worker] {
+					for (std::size_t i = next_file++; i<ss_inputs.size(); i = next_file++) {
+						const auto& file = ss_inputs[i];
+						auto s = high_resolution_clock::now();
+						std::size_t records_processed = 0;
+						std::size_t row_allocations = 0;
+						auto header_index = processor.Process(file, user_safe_list, counters[worker], records_processed, row_allocations);
+						auto e = high_resolution_clock::now();
+						auto d = duration_cast<microseconds>(e-s);
+						std::lock_guard<std::mutex> lock(output_lock);
+						total_records_processed += records_processed;
+						std::cout << std::left << "### Analysis Completed ###" << std::endl
+								  << std::right << std::setw(25) <<  "Analysis Time: "
+								  << std::left << std::setprecision(9) << (double)d.count()/1000000 << "s" << std::endl
+								  << std::right << std::setw(25) <<  "Records Processed: "
+								  << std::left << records_processed << std::endl;
+						if (Proofpoint::Memory::tracked)
+							std::cout << std::right << std::setw(25) <<  "Row Allocations: "
+									  << std::left << row_allocations << std::endl;
+						std::cout << std::right << std::setw(25) <<  "Throughput: "
+								  << std::left << std::setprecision(3) << throughput(file, d) << " GB/s" << std::endl
+								  << std::right << std::setw(25) << "Smart Search File: "
+								  << file << (!header_index ? " (No CSV Header Found)" : "") << std::endl << std::endl;
+					}
+				});
+			}
 		}
+		auto analysis_wall = duration_cast<microseconds>(high_resolution_clock::now()-analysis_start);
+		analysis_cpu = cpu_time()-analysis_cpu;
+
+		for (const auto& c : counters)
+			user_safe_list.Merge(c);
+
 		std::cout << std::left << "### Analysis Summary ###" << std::endl
 		          << std::right << std::setw(25) <<  "Total Safe Listed: "
 				  << std::left << user_safe_list.GetSafeCount() << std::endl
 				  << std::right << std::setw(25) <<  "Total Block Listed: "
-				  << std::left << user_safe_list.GetBlockCount() << std::endl << std::endl;
+				  << std::left << user_safe_list.GetBlockCount() << std::endl
+				  << std::right << std::setw(25) <<  "Threads: "
+				  << std::left << threads << std::endl
+				  << std::right << std::setw(25) <<  "Wall Clock Time: "
+				  << std::left << std::setprecision(9) << (double)analysis_wall.count()/1000000 << "s" << std::endl
+				  << std::right << std::setw(25) <<  "CPU Time: "
+				  << std::left << std::setprecision(9) << analysis_cpu << "s" << std::endl << std::endl;
 
 		s = high_resolution_clock::now();
 		user_safe_list.Save(output_list, extended);
@@ -0,0 +1,228 @@
+/**
+ * This code was tested against C++20
+ *
+ * @author Ludvik Jerabek
+ * @package slanalyzer
+ * @version 1.0.0
+ * @license MIT
+ */
+#ifndef SLANALYZER_AFFIXMATCHER_H
+#define SLANALYZER_AFFIXMATCHER_H
+
+#include "IMatcher.h"
+#include "Utils.h"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Proofpoint
+{
+	// Case-insensitive ASCII literals a value starts (PREFIX) or ends (SUFFIX) with, what
+	// ^example or example\.com$ match as regexes.
+	//
+	// The literals share an open addressing table keyed by the FNV-1a hash of the folded
+	// literal read from the anchored end, so the hash of a value grows one character at a
+	// time from that end and is probed at every length a literal has. Values are folded with
+	// Utils::ascii_fold_next first, a non-ASCII character which doesn't fold onto ASCII
+	// becomes a byte no literal holds.
+	template <typename T>
+	class AffixMatcher final : public IMatcher<T>
+	{
+	public:
+		enum class Side
+		{
+			PREFIX,
+			SUFFIX
+		};
+
+		explicit AffixMatcher(Side side) : side(side)
+		{
+		}
+
+	public:
+		// pattern must be ASCII, see RegexLiteral
+		void Add(const std::string& pattern, const T& index, PatternErrors<T>& pattern_errors) override;
+		void Compile(PatternErrors<T>& pattern_errors) override;
+		bool Match(std::string_view pattern, std::vector<T>& match_indexes, MatchScratch<T>& scratch) const override;
+		std::size_t GetPatternCount() const override;
+		std::vector<T> GetPatternIndexes() const override;
+
+		// See IMatcher::Match
+		bool MatchAscii(std::string_view text, std::string_view lower, std::vector<T>& match_indexes,
+		                MatchScratch<T>& scratch) const;
+
+	private:
+		struct Slot
+		{
+			std::uint64_t hash;
+			std::uint32_t key;
+			std::uint32_t length;
+			std::uint32_t postings;
+			std::uint32_t count; // Zero marks an empty slot
+		};
+
+		static constexpr std::uint64_t HASH_BASIS = 0xcbf29ce484222325ULL;
+		static constexpr std::uint64_t HASH_PRIME = 0x100000001b3ULL;
+
+		// Character i of text counted from the anchored end
+		char At(std::string_view text, std::size_t i) const
+		{
+			return side == Side::PREFIX ? text[i] : text[text.size() - 1 - i];
+		}
+
+		void Build();
+		// Appends the entries of every literal the folded text starts or ends with
+		void Find(std::string_view text, std::vector<T>& match_indexes) const;
+
+	private:
+		Side side;
+		std::once_flag built;
+		// Folded literals waiting for the table to be built
+		std::vector<std::pair<std::string, T>> pending;
+		std::size_t count = 0;
+		std::vector<Slot> table;
+		std::uint64_t mask = 0;
+		// Keys in reading order from the anchored end
+		std::string keys;
+		std::vector<T> postings;
+		// Whether a literal has each length
+		std::vector<bool> lengths;
+	};
+
+	template <typename T>
+	void AffixMatcher<T>::Add(const std::string& pattern, const T& index, PatternErrors<T>&)
+	{
+		std::string folded(pattern);
+		std::transform(folded.begin(), folded.end(), folded.begin(), Utils::ascii_lower);
+		if (side == Side::SUFFIX)
+			std::reverse(folded.begin(), folded.end());
+		pending.emplace_back(std::move(folded), index);
+		count++;
+	}
+
+	template <typename T>
+	void AffixMatcher<T>::Build()
+	{
+		// Equal keys are grouped so each one gets a single slot with a run of postings
+		std::stable_sort(pending.begin(), pending.end(), [](const auto& a, const auto& b)
+		{
+			return a.first < b.first;
+		});
+
+		table.assign(std::bit_ceil(std::max<std::size_t>(pending.size() * 2, 16)), Slot{0, 0, 0, 0, 0});
+		mask = table.size() - 1;
+		postings.reserve(pending.size());
+
+		for (std::size_t i = 0; i < pending.size();)
+		{
+			const std::string& key = pending[i].first;
+			Slot slot{HASH_BASIS, static_cast<std::uint32_t>(keys.size()), static_cast<std::uint32_t>(key.size()),
+			          static_cast<std::uint32_t>(postings.size()), 0};
+			for (char c : key)
+				slot.hash = (slot.hash ^ static_cast<unsigned char>(c)) * HASH_PRIME;
+			keys += key;
+
+			if (lengths.size() <= key.size())
+				lengths.resize(key.size() + 1);
+			lengths[key.size()] = true;
+
+			for (; i < pending.size() && pending[i].first == key; i++)
+			{
+				postings.push_back(pending[i].second);
+				slot.count++;
+			}
+
+			std::uint64_t position = slot.hash & mask;
+			while (table[position].count)
+				position = (position + 1) & mask;
+			table[position] = slot;
+		}
+
+		pending.clear();
+		pending.shrink_to_fit();
+	}
+
+	template <typename T>
+	void AffixMatcher<T>::Compile(PatternErrors<T>&)
+	{
+		std::call_once(built, [this] { Build(); });
+	}
+
+	template <typename T>
+	void AffixMatcher<T>::Find(std::string_view text, std::vector<T>& match_indexes) const
+	{
+		const std::size_t longest = std::min(text.size(), lengths.size() - 1);
+		std::uint64_t hash = HASH_BASIS;
+		for (std::size_t length = 1; length <= longest; length++)
+		{
+			hash = (hash ^ static_cast<unsigned char>(At(text, length - 1))) * HASH_PRIME;
+			if (!lengths[length])
+				continue;
+
+			for (std::uint64_t position = hash & mask; table[position].count; position = (position + 1) & mask)
+			{
+				const Slot& slot = table[position];
+				if (slot.hash != hash || slot.length != length)
+					continue;
+
+				std::size_t i = 0;
+				while (i < length && At(text, i) == keys[slot.key + i])
+					i++;
+				if (i != length)
+					continue;
+
+				match_indexes.insert(match_indexes.end(), postings.begin() + slot.postings,
+				                     postings.begin() + slot.postings + slot.count);
+				break;
+			}
+		}
+	}
+
+	template <typename T>
+	bool AffixMatcher<T>::Match(std::string_view pattern, std::vector<T>& match_indexes,
+	                            MatchScratch<T>& scratch) const
+	{
+		match_indexes.clear();
+		if (table.empty())
+			return false;
+
+		std::string& folded = scratch.text;
+		folded.clear();
+		for (std::size_t i = 0; i < pattern.size();)
+		{
+			const int c = Utils::ascii_fold_next(pattern, i);
+			folded.push_back(c < 0 ? '\x80' : static_cast<char>(c));
+		}
+		Find(folded, match_indexes);
+		return !match_indexes.empty();
+	}
+
+	template <typename T>
+	bool AffixMatcher<T>::MatchAscii(std::string_view, std::string_view lower, std::vector<T>& match_indexes,
+	                                 MatchScratch<T>&) const
+	{
+		match_indexes.clear();
+		if (table.empty())
+			return false;
+
+		Find(lower, match_indexes);
+		return !match_indexes.empty();
+	}
+
+	template <typename T>
+	std::vector<T> AffixMatcher<T>::GetPatternIndexes() const
+	{
+		return postings;
+	}
+
+	template <typename T>
+	std::size_t AffixMatcher<T>::GetPatternCount() const
+	{
+		return count;
+	}
+}
+#endif //SLANALYZER_AFFIXMATCHER_H
@@ -0,0 +1,392 @@
+/**
+ * This code was tested against C++20
+ *
+ * @author Ludvik Jerabek
+ * @package slanalyzer
+ * @version 1.0.0
+ * @license MIT
+ */
+#ifndef SLANALYZER_AHOCORASICKMATCHER_H
+#define SLANALYZER_AHOCORASICKMATCHER_H
+
+#include "IMatcher.h"
+#include "Matcher.h"
+#include "Utils.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Proofpoint
+{
+	// Case-insensitive multi-literal substring search, a drop in replacement for
+	// Matcher(true, false, RE2::UNANCHORED) which reports every pattern found in the text.
+	//
+	// ASCII patterns are compiled into an Aho-Corasick automaton over byte classes: only
+	// bytes used by a pattern get a class of their own, upper case letters share the class
+	// of their lower case form and everything else shares class 0. The shallowest states
+	// have dense rows of transitions, up to MAX_DENSE_MEMORY, so a text costs one table
+	// lookup per byte while it's near the root whatever the number of patterns, where a
+	// large RE2::Set keeps rebuilding DFA states within its memory cap. Deeper states only
+	// keep their trie edges and follow failure links, which keeps a large list from growing
+	// a row per character of every pattern. Text is folded with Utils::ascii_fold_next,
+	// patterns which aren't ASCII stay in RE2.
+	template <typename T>
+	class AhoCorasickMatcher final : public IMatcher<T>
+	{
+	public:
+		AhoCorasickMatcher() : other(true, false, RE2::UNANCHORED)
+		{
+		}
+
+	public:
+		void Add(const std::string& pattern, const T& index, PatternErrors<T>& pattern_errors) override;
+		void Compile(PatternErrors<T>& pattern_errors) override;
+		bool Match(std::string_view pattern, std::vector<T>& match_indexes, MatchScratch<T>& scratch) const override;
+		std::size_t GetPatternCount() const override;
+		std::vector<T> GetPatternIndexes() const override;
+
+		// See IMatcher::Match
+		bool MatchAscii(std::string_view text, std::string_view lower, std::vector<T>& match_indexes,
+		                MatchScratch<T>& scratch) const;
+
+		void GetRegexStat(RegexStat& stat) const override
+		{
+			other.GetRegexStat(stat);
+		}
+
+	private:
+		static constexpr std::uint32_t NONE = std::numeric_limits<std::uint32_t>::max();
+		// Cap on the dense rows of one automaton
+		static constexpr std::size_t MAX_DENSE_MEMORY = 4 << 20;
+
+		struct Edge
+		{
+			std::uint32_t target;
+			std::uint8_t cls;
+		};
+
+		void Build();
+
+		// Transition of state on class cls, a state without a dense row follows its trie
+		// edges or else its failure link until one with a row
+		std::uint32_t Step(std::uint32_t state, std::uint8_t cls) const
+		{
+			while (state >= dense_states)
+			{
+				for (std::uint32_t e = edge_offsets[state]; e < edge_offsets[state + 1]; e++)
+				{
+					if (edges[e].cls == cls)
+					{
+						return edges[e].target;
+					}
+				}
+				state = fail[state];
+			}
+			return delta[state * class_count + cls];
+		}
+
+		// Runs the automaton over size characters, next() returning each folded one or -1, and
+		// appends the entries of the patterns found
+		template <typename Next>
+		void Search(std::size_t size, Next&& next, std::vector<T>& match_indexes, MatchScratch<T>& scratch) const;
+
+		// Adds every pattern ending in state, following the dictionary suffix links
+		void Report(std::uint32_t state, std::vector<std::uint32_t>& hits) const
+		{
+			// The root is its own failure state and ends every chain
+			for (std::uint32_t s = report[state]; s != NONE; s = s ? report[fail[s]] : NONE)
+			{
+				hits.push_back(s);
+			}
+		}
+
+	private:
+		std::once_flag built;
+		// Folded ASCII patterns waiting for the automaton to be built
+		std::vector<std::pair<std::string, T>> pending;
+		std::size_t ascii_count = 0;
+
+		std::array<std::uint8_t, 256> classes{};
+		std::size_t class_count = 1;
+		// States are numbered breadth first, those below dense_states have the transition on
+		// class c at s * class_count + c
+		std::uint32_t dense_states = 0;
+		std::vector<std::uint32_t> delta;
+		// Trie edges of state s from edge_offsets[s] up to edge_offsets[s + 1]
+		std::vector<std::uint32_t> edge_offsets;
+		std::vector<Edge> edges;
+		std::vector<std::uint32_t> fail;
+		// Nearest state along the failure chain (itself included) where a pattern ends
+		std::vector<std::uint32_t> report;
+		// Entry indexes of the patterns ending in each state
+		std::vector<std::pair<std::uint32_t, std::uint32_t>> outputs;
+		std::vector<T> postings;
+
+		// Patterns which aren't ASCII
+		Matcher<T> other;
+	};
+
+	template <typename T>
+	void AhoCorasickMatcher<T>::Add(const std::string& pattern, const T& index, PatternErrors<T>& pattern_errors)
+	{
+		if (!Utils::is_ascii(pattern))
+		{
+			other.Add(pattern, index, pattern_errors);
+			return;
+		}
+
+		std::string folded(pattern);
+		std::transform(folded.begin(), folded.end(), folded.begin(), Utils::ascii_lower);
+		pending.emplace_back(std::move(folded), index);
+		ascii_count++;
+	}
+
+	template <typename T>
+	void AhoCorasickMatcher<T>::Build()
+	{
+		// Byte classes, upper case letters read as their lower case class
+		for (const auto& [key, index] : pending)
+		{
+			for (char c : key)
+			{
+				auto& cls = classes[static_cast<unsigned char>(c)];
+				if (!cls)
+				{
+					cls = static_cast<std::uint8_t>(class_count++);
+				}
+			}
+		}
+		for (int c = 'A'; c <= 'Z'; c++)
+		{
+			classes[c] = classes[Utils::ascii_lower(static_cast<char>(c))];
+		}
+
+		// Trie, sorted keys sharing a prefix are neighbours so each key only adds the states
+		// past the prefix it shares with the one before
+		std::stable_sort(pending.begin(), pending.end(), [](const auto& a, const auto& b)
+		{
+			return a.first < b.first;
+		});
+
+		std::vector<std::uint32_t> parent{NONE}, depth{0}, ends;
+		std::vector<std::uint8_t> label{0};
+		std::vector<std::uint32_t> path{0};
+		std::string_view previous;
+		ends.reserve(pending.size());
+		for (const auto& [key, index] : pending)
+		{
+			std::size_t shared = std::mismatch(key.begin(), key.end(), previous.begin(), previous.end()).first - key.begin();
+			path.resize(shared + 1);
+			for (std::size_t i = shared; i < key.size(); i++)
+			{
+				path.push_back(static_cast<std::uint32_t>(parent.size()));
+				parent.push_back(path[i]);
+				depth.push_back(static_cast<std::uint32_t>(i + 1));
+				label.push_back(classes[static_cast<unsigned char>(key[i])]);
+			}
+			ends.push_back(path.back());
+			previous = key;
+		}
+
+		// States renumbered breadth first, a failure link always points to a lower number
+		const std::size_t states = parent.size();
+		std::vector<std::uint32_t> rank(states), first(states + 1, 0);
+		for (std::size_t s = 0; s < states; s++)
+		{
+			first[depth[s] + 1]++;
+		}
+		for (std::size_t d = 1; d <= states; d++)
+		{
+			first[d] += first[d - 1];
+		}
+		for (std::size_t s = 0; s < states; s++)
+		{
+			rank[s] = first[depth[s]]++;
+		}
+
+		// Trie edges grouped by state
+		edges.resize(states - 1);
+		edge_offsets.assign(states + 1, 0);
+		for (std::size_t s = 1; s < states; s++)
+		{
+			edge_offsets[rank[parent[s]] + 1]++;
+		}
+		for (std::size_t s = 1; s <= states; s++)
+		{
+			edge_offsets[s] += edge_offsets[s - 1];
+		}
+		std::vector<std::uint32_t> fill(edge_offsets.begin(), edge_offsets.end() - 1);
+		for (std::size_t s = 1; s < states; s++)
+		{
+			edges[fill[rank[parent[s]]]++] = {rank[s], label[s]};
+		}
+
+		// Entries of the patterns ending in each state, equal keys keep the order they were added
+		std::vector<std::uint32_t> counts(states + 1, 0);
+		for (auto end : ends)
+		{
+			counts[rank[end] + 1]++;
+		}
+		for (std::size_t s = 1; s <= states; s++)
+		{
+			counts[s] += counts[s - 1];
+		}
+		outputs.resize(states);
+		for (std::size_t s = 0; s < states; s++)
+		{
+			outputs[s] = {counts[s], counts[s + 1] - counts[s]};
+		}
+		postings.resize(pending.size());
+		for (std::size_t i = 0; i < pending.size(); i++)
+		{
+			postings[counts[rank[ends[i]]]++] = pending[i].second;
+		}
+		pending.clear();
+		pending.shrink_to_fit();
+
+		// The shallowest states, where a text spends most of its bytes, get dense rows
+		dense_states = static_cast<std::uint32_t>(
+			std::clamp<std::size_t>(MAX_DENSE_MEMORY / (class_count * sizeof(std::uint32_t)), 1, states));
+		delta.assign(dense_states * class_count, NONE);
+		for (std::uint32_t s = 0; s < dense_states; s++)
+		{
+			for (std::uint32_t e = edge_offsets[s]; e < edge_offsets[s + 1]; e++)
+			{
+				delta[s * class_count + edges[e].cls] = edges[e].target;
+			}
+		}
+
+		// Failure links in breadth first order, completing the dense rows along the way
+		fail.assign(states, 0);
+		report.assign(states, NONE);
+		for (std::uint32_t s = 0; s < states; s++)
+		{
+			report[s] = outputs[s].second ? s : (s ? report[fail[s]] : NONE);
+			for (std::uint32_t e = edge_offsets[s]; e < edge_offsets[s + 1]; e++)
+			{
+				fail[edges[e].target] = s ? Step(fail[s], edges[e].cls) : 0;
+			}
+			if (s < dense_states)
+			{
+				for (std::size_t c = 0; c < class_count; c++)
+				{
+					std::uint32_t& next = delta[s * class_count + c];
+					if (next == NONE)
+					{
+						next = s ? Step(fail[s], static_cast<std::uint8_t>(c)) : 0;
+					}
+				}
+			}
+		}
+	}
+
+	template <typename T>
+	void AhoCorasickMatcher<T>::Compile(PatternErrors<T>& pattern_errors)
+	{
+		std::call_once(built, [this] { Build(); });
+		if (other.GetPatternCount())
+		{
+			other.Compile(pattern_errors);
+		}
+	}
+
+	template <typename T>
+	template <typename Next>
+	void AhoCorasickMatcher<T>::Search(std::size_t size, Next&& next, std::vector<T>& match_indexes,
+	                                   MatchScratch<T>& scratch) const
+	{
+		// States where patterns ended, each pattern is reported once however often it occurs
+		std::vector<std::uint32_t>& hits = scratch.states;
+		hits.clear();
+		Report(0, hits);
+
+		// Dense rows are looked up in place, they're what most bytes go through
+		const std::uint32_t* rows = delta.data();
+		const std::uint32_t dense = dense_states;
+		const std::size_t width = class_count;
+		std::uint32_t state = 0;
+		for (std::size_t i = 0; i < size;)
+		{
+			const int c = next(i);
+			const std::uint8_t cls = c < 0 ? 0 : classes[static_cast<unsigned char>(c)];
+			state = state < dense ? rows[state * width + cls] : Step(state, cls);
+			if (report[state] != NONE)
+			{
+				Report(state, hits);
+			}
+		}
+
+		std::sort(hits.begin(), hits.end());
+		hits.erase(std::unique(hits.begin(), hits.end()), hits.end());
+		for (auto s : hits)
+		{
+			match_indexes.insert(match_indexes.end(), postings.begin() + outputs[s].first,
+			                     postings.begin() + outputs[s].first + outputs[s].second);
+		}
+	}
+
+	template <typename T>
+	bool AhoCorasickMatcher<T>::Match(std::string_view pattern, std::vector<T>& match_indexes,
+                                      MatchScratch<T>& scratch) const
+	{
+		match_indexes.clear();
+
+		// The automaton is built by Compile, there's nothing to run before
+		if (ascii_count && !delta.empty())
+		{
+			Search(pattern.size(), [pattern](std::size_t& i) { return Utils::ascii_fold_next(pattern, i); },
+			       match_indexes, scratch);
+		}
+
+		if (other.GetPatternCount())
+		{
+			other.Match(pattern, scratch.indexes, scratch);
+			match_indexes.insert(match_indexes.end(), scratch.indexes.begin(), scratch.indexes.end());
+		}
+
+		return !match_indexes.empty();
+	}
+
+	template <typename T>
+	bool AhoCorasickMatcher<T>::MatchAscii(std::string_view text, std::string_view lower,
+	                                       std::vector<T>& match_indexes, MatchScratch<T>& scratch) const
+	{
+		match_indexes.clear();
+
+		if (ascii_count && !delta.empty())
+		{
+			Search(lower.size(), [lower](std::size_t& i) { return static_cast<int>(lower[i++]); }, match_indexes,
+			       scratch);
+		}
+
+		if (other.GetPatternCount())
+		{
+			other.MatchAscii(text, lower, scratch.indexes, scratch);
+			match_indexes.insert(match_indexes.end(), scratch.indexes.begin(), scratch.indexes.end());
+		}
+
+		return !match_indexes.empty();
+	}
+
+	template <typename T>
+	std::vector<T> AhoCorasickMatcher<T>::GetPatternIndexes() const
+	{
+		// Every ASCII pattern left one posting behind
+		std::vector<T> indexes(postings);
+		std::vector<T> other_indexes = other.GetPatternIndexes();
+		indexes.insert(indexes.end(), other_indexes.begin(), other_indexes.end());
+		return indexes;
+	}
+
+	template <typename T>
+	std::size_t AhoCorasickMatcher<T>::GetPatternCount() const
+	{
+		return ascii_count + other.GetPatternCount();
+	}
+}
+#endif //SLANALYZER_AHOCORASICKMATCHER_H
@@ -0,0 +1,219 @@
+/**
+ * This code was tested against C++20
+ *
+ * @author Ludvik Jerabek
+ * @package slanalyzer
+ * @version 1.0.0
+ * @license MIT
+ */
+#ifndef SLANALYZER_DOMAINPARTITIONMATCHER_H
+#define SLANALYZER_DOMAINPARTITIONMATCHER_H
+
+#include "IMatcher.h"
+#include "AffixMatcher.h"
+#include "FilteredMatcher.h"
+#include "Matcher.h"
+#include "RegexLiteral.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace Proofpoint
+{
+	// Case-insensitive unanchored regexes of an address field split by the domain they end
+	// with, a drop in replacement for FilteredMatcher.
+	//
+	// Vendor entries like ^.*@mail\.vendor\.com$ can only match an address ending in
+	// @mail.vendor.com. Each regex whose matches all end in a literal (see
+	// RegexLiteral::RequiredSuffix) is keyed by that literal from its last @, or from its
+	// first dot when it has none, and regexes sharing a key form a partition of their own.
+	// A value looks up the keys it ends with, @mail.vendor.com, .vendor.com, .com, in an
+	// AffixMatcher and only runs those partitions and the residual regexes without a key.
+	//
+	// Below MIN_PARTITIONED_PATTERNS every regex stays in the residual engine, whose DFA
+	// still covers them in one pass.
+	template <typename T>
+	class DomainPartitionMatcher final : public IMatcher<T>
+	{
+	public:
+		// max_mem is the budget of each RE2 set as in Matcher, partition false keeps every
+		// regex in the residual engine for fields which aren't addresses
+		explicit DomainPartitionMatcher(bool partition = false, std::int64_t max_mem = Matcher<T>::DEFAULT_MAX_MEM)
+			: partition(partition), max_mem(max_mem), domains(AffixMatcher<T>::Side::SUFFIX), residual(max_mem)
+		{
+		}
+
+	public:
+		void Add(const std::string& pattern, const T& index, PatternErrors<T>& pattern_errors) override;
+		void Compile(PatternErrors<T>& pattern_errors) override;
+		bool Match(std::string_view pattern, std::vector<T>& match_indexes, MatchScratch<T>& scratch) const override;
+		std::size_t GetPatternCount() const override;
+		std::vector<T> GetPatternIndexes() const override;
+		void GetRegexStat(RegexStat& stat) const override;
+
+		// See IMatcher::Match
+		bool MatchAscii(std::string_view text, std::string_view lower, std::vector<T>& match_indexes,
+		                MatchScratch<T>& scratch) const;
+
+		// The key a regex is partitioned by, empty when it has none
+		static std::string Key(std::string_view pattern);
+
+	private:
+		static constexpr std::size_t MIN_PARTITIONED_PATTERNS = 256;
+
+		void Build(PatternErrors<T>& pattern_errors);
+
+	private:
+		bool partition;
+		std::int64_t max_mem;
+		std::once_flag built;
+		// Patterns and entries as added, released once built
+		std::vector<std::pair<std::string, T>> pending;
+		// Key of each partition, the postings of domains are partitions
+		AffixMatcher<T> domains;
+		std::vector<std::unique_ptr<FilteredMatcher<T>>> partitions;
+		FilteredMatcher<T> residual;
+	};
+
+	template <typename T>
+	std::string DomainPartitionMatcher<T>::Key(std::string_view pattern)
+	{
+		std::string suffix = RegexLiteral::RequiredSuffix(pattern);
+		std::size_t start = suffix.rfind('@');
+		if (start == std::string::npos)
+			start = suffix.find('.');
+		if (start == std::string::npos || start + 1 == suffix.size())
+			return {};
+		return suffix.substr(start);
+	}
+
+	template <typename T>
+	void DomainPartitionMatcher<T>::Add(const std::string& pattern, const T& index, PatternErrors<T>& pattern_errors)
+	{
+		if (!partition)
+		{
+			residual.Add(pattern, index, pattern_errors);
+			return;
+		}
+		pending.emplace_back(pattern, index);
+	}
+
+	template <typename T>
+	void DomainPartitionMatcher<T>::Build(PatternErrors<T>& pattern_errors)
+	{
+		if (pending.size() < MIN_PARTITIONED_PATTERNS)
+		{
+			for (const auto& [pattern, index] : pending)
+			{
+				residual.Add(pattern, index, pattern_errors);
+			}
+		}
+		else
+		{
+			std::unordered_map<std::string, std::size_t> keys;
+			for (const auto& [pattern, index] : pending)
+			{
+				std::string key = Key(pattern);
+				if (key.empty())
+				{
+					residual.Add(pattern, index, pattern_errors);
+					continue;
+				}
+
+				auto [it, added] = keys.try_emplace(key, partitions.size());
+				if (added)
+				{
+					partitions.push_back(std::make_unique<FilteredMatcher<T>>(max_mem));
+					domains.Add(key, static_cast<T>(it->second), pattern_errors);
+				}
+				partitions[it->second]->Add(pattern, index, pattern_errors);
+			}
+			domains.Compile(pattern_errors);
+			for (auto& matcher : partitions)
+			{
+				matcher->Compile(pattern_errors);
+			}
+		}
+
+		residual.Compile(pattern_errors);
+		pending.clear();
+		pending.shrink_to_fit();
+	}
+
+	template <typename T>
+	void DomainPartitionMatcher<T>::Compile(PatternErrors<T>& pattern_errors)
+	{
+		std::call_once(built, [this, &pattern_errors] { Build(pattern_errors); });
+	}
+
+	template <typename T>
+	bool DomainPartitionMatcher<T>::Match(std::string_view pattern, std::vector<T>& match_indexes,
+	                                      MatchScratch<T>& scratch) const
+	{
+		residual.Match(pattern, match_indexes, scratch);
+		if (partitions.empty() || !domains.Match(pattern, scratch.partitions, scratch))
+			return !match_indexes.empty();
+
+		for (const T& id : scratch.partitions)
+		{
+			if (partitions[id]->Match(pattern, scratch.partial, scratch))
+				match_indexes.insert(match_indexes.end(), scratch.partial.begin(), scratch.partial.end());
+		}
+		return !match_indexes.empty();
+	}
+
+	template <typename T>
+	bool DomainPartitionMatcher<T>::MatchAscii(std::string_view text, std::string_view lower,
+	                                           std::vector<T>& match_indexes, MatchScratch<T>& scratch) const
+	{
+		residual.MatchAscii(text, lower, match_indexes, scratch);
+		if (partitions.empty() || !domains.MatchAscii(text, lower, scratch.partitions, scratch))
+			return !match_indexes.empty();
+
+		for (const T& id : scratch.partitions)
+		{
+			if (partitions[id]->MatchAscii(text, lower, scratch.partial, scratch))
+				match_indexes.insert(match_indexes.end(), scratch.partial.begin(), scratch.partial.end());
+		}
+		return !match_indexes.empty();
+	}
+
+	template <typename T>
+	std::vector<T> DomainPartitionMatcher<T>::GetPatternIndexes() const
+	{
+		std::vector<T> indexes = residual.GetPatternIndexes();
+		for (const auto& matcher : partitions)
+		{
+			std::vector<T> rest = matcher->GetPatternIndexes();
+			indexes.insert(indexes.end(), rest.begin(), rest.end());
+		}
+		return indexes;
+	}
+
+	template <typename T>
+	std::size_t DomainPartitionMatcher<T>::GetPatternCount() const
+	{
+		// Patterns added until Compile sorts them out
+		std::size_t count = pending.size() + residual.GetPatternCount();
+		for (const auto& matcher : partitions)
+		{
+			count += matcher->GetPatternCount();
+		}
+		return count;
+	}
+
+	template <typename T>
+	void DomainPartitionMatcher<T>::GetRegexStat(RegexStat& stat) const
+	{
+		residual.GetRegexStat(stat);
+		for (const auto& matcher : partitions)
+		{
+			matcher->GetRegexStat(stat);
+		}
+		stat.partitions += partitions.size();
+	}
+}
+#endif //SLANALYZER_DOMAINPARTITIONMATCHER_H
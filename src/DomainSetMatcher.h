@@ -0,0 +1,124 @@
+/**
+ * This code was tested against C++20
+ *
+ * @author Ludvik Jerabek
+ * @package slanalyzer
+ * @version 1.0.0
+ * @license MIT
+ */
+#ifndef SLANALYZER_DOMAINSETMATCHER_H
+#define SLANALYZER_DOMAINSETMATCHER_H
+
+#include "IMatcher.h"
+#include "DomainSets.h"
+#include "Utils.h"
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace Proofpoint
+{
+	// is_in_domainset entries of one field, the pattern names a set of the shared index.
+	// The domain of a value is everything after its last @, a host or helo is a domain as
+	// is. It matches a set holding the domain or any of its parent domains, in any case.
+	template <typename T>
+	class DomainSetMatcher final : public IMatcher<T>
+	{
+	public:
+		explicit DomainSetMatcher(const DomainSets& domain_sets) : domain_sets(domain_sets)
+		{
+		}
+
+	public:
+		void Add(const std::string& pattern, const T& index, PatternErrors<T>& pattern_errors) override;
+		void Compile(PatternErrors<T>& pattern_errors) override;
+		bool Match(std::string_view pattern, std::vector<T>& match_indexes, MatchScratch<T>& scratch) const override;
+		std::size_t GetPatternCount() const override;
+		std::vector<T> GetPatternIndexes() const override;
+
+	private:
+		const DomainSets& domain_sets;
+		std::once_flag built;
+		// Set and entry of each pattern until the entries are grouped by set
+		std::vector<std::pair<int, T>> pending;
+		std::vector<T> indexes;
+		// Entries of set id are entries[set_offsets[id]] up to entries[set_offsets[id + 1]]
+		std::vector<uint32_t> set_offsets;
+		std::vector<T> entries;
+	};
+
+	template <typename T>
+	void DomainSetMatcher<T>::Add(const std::string& pattern, const T& index, PatternErrors<T>& pattern_errors)
+	{
+		const int set = domain_sets.Find(Utils::trim_copy(pattern));
+		if (set == -1)
+		{
+			pattern_errors.push_back({index, pattern, "Domain set [" + pattern + "] is not loaded"});
+			return;
+		}
+		pending.emplace_back(set, index);
+		indexes.push_back(index);
+	}
+
+	template <typename T>
+	void DomainSetMatcher<T>::Compile(PatternErrors<T>&)
+	{
+		std::call_once(built, [this]
+		{
+			std::stable_sort(pending.begin(), pending.end(), [](const auto& a, const auto& b)
+			{
+				return a.first < b.first;
+			});
+
+			set_offsets.assign(domain_sets.GetSetCount() + 1, 0);
+			for (const auto& [set, index] : pending)
+				set_offsets[set + 1]++;
+			for (std::size_t i = 1; i < set_offsets.size(); i++)
+				set_offsets[i] += set_offsets[i - 1];
+			for (const auto& [set, index] : pending)
+				entries.push_back(index);
+
+			pending.clear();
+			pending.shrink_to_fit();
+		});
+	}
+
+	template <typename T>
+	bool DomainSetMatcher<T>::Match(std::string_view pattern, std::vector<T>& match_indexes,
+	                                MatchScratch<T>& scratch) const
+	{
+		match_indexes.clear();
+
+		// npos + 1 wraps to 0, a value without @ is a domain already
+		const std::string_view domain = pattern.substr(pattern.rfind('@') + 1);
+		std::vector<int>& sets = scratch.ids;
+		sets.clear();
+		domain_sets.Lookup(domain, sets);
+
+		if (sets.empty())
+			return false;
+
+		// A set holding both a domain and its parent counts its entries once
+		std::sort(sets.begin(), sets.end());
+		sets.erase(std::unique(sets.begin(), sets.end()), sets.end());
+		for (int set : sets)
+		{
+			match_indexes.insert(match_indexes.end(), entries.begin() + set_offsets[set],
+			                     entries.begin() + set_offsets[set + 1]);
+		}
+		return !match_indexes.empty();
+	}
+
+	template <typename T>
+	std::size_t DomainSetMatcher<T>::GetPatternCount() const
+	{
+		return indexes.size();
+	}
+
+	template <typename T>
+	std::vector<T> DomainSetMatcher<T>::GetPatternIndexes() const
+	{
+		return indexes;
+	}
+}
+#endif //SLANALYZER_DOMAINSETMATCHER_H
@@ -0,0 +1,192 @@
+/**
+ * This code was tested against C++20
+ *
+ * @author Ludvik Jerabek
+ * @package slanalyzer
+ * @version 1.0.0
+ * @license MIT
+ */
+#include "DomainSets.h"
+#include "MappedCsvParser.h"
+#include "Utils.h"
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <limits>
+#include <stdexcept>
+
+bool Proofpoint::DomainSets::Load(const std::string& name, const std::string& file, std::string& error)
+{
+	// A set which fails to load leaves nothing behind, the next one takes its id
+	const std::size_t pending_size = pending.size();
+	const std::size_t domains_size = domains.size();
+	const std::size_t domain_total = domain_count;
+	const auto rollback = [&]
+	{
+		pending.resize(pending_size);
+		domains.resize(domains_size);
+		domain_count = domain_total;
+		return false;
+	};
+
+	try
+	{
+		csv::MappedFile mapped(file);
+		const std::string_view text = mapped.view();
+		const int set = static_cast<int>(names.size());
+
+		for (std::size_t start = 0; start < text.size();)
+		{
+			std::size_t end = text.find('\n', start);
+			if (end == std::string_view::npos)
+				end = text.size();
+			std::string_view line = text.substr(start, end - start);
+			start = end + 1;
+
+			while (!line.empty() && std::isspace(static_cast<unsigned char>(line.front())))
+				line.remove_prefix(1);
+			while (!line.empty() && std::isspace(static_cast<unsigned char>(line.back())))
+				line.remove_suffix(1);
+			if (line.starts_with('#'))
+				continue;
+			if (line.starts_with("*."))
+				line.remove_prefix(2);
+			if (line.starts_with('.'))
+				line.remove_prefix(1);
+			if (line.ends_with('.'))
+				line.remove_suffix(1);
+			if (line.empty())
+				continue;
+
+			if (domains.size() + line.size() >= std::numeric_limits<uint32_t>::max())
+			{
+				error = "Domain sets exceed 4 GB [" + file + "]";
+				return rollback();
+			}
+
+			pending.push_back({static_cast<uint32_t>(domains.size()), static_cast<uint32_t>(line.size()), set});
+			for (const char c : line)
+				domains.push_back(Utils::ascii_lower(c));
+			domain_count++;
+		}
+	}
+	catch (const std::exception& e)
+	{
+		error = "Unable to load domain set [" + name + "]: " + e.what();
+		return rollback();
+	}
+
+	names.push_back(name);
+	return true;
+}
+
+void Proofpoint::DomainSets::Build()
+{
+	const auto domain = [this](const Pending& p)
+	{
+		return std::string_view(domains).substr(p.offset, p.length);
+	};
+
+	// Equal domains are grouped so each one gets a single slot with a run of sets
+	std::sort(pending.begin(), pending.end(), [&domain](const Pending& a, const Pending& b)
+	{
+		const int order = domain(a).compare(domain(b));
+		return order < 0 || (order == 0 && a.set < b.set);
+	});
+
+	table.assign(std::bit_ceil(std::max<std::size_t>(pending.size() * 2, 16)), Slot{0, 0, 0, 0});
+	mask = table.size() - 1;
+
+	// Duplicates are dropped as the domains move into their final buffer
+	std::string unique;
+	unique.reserve(domains.size());
+
+	for (std::size_t i = 0; i < pending.size();)
+	{
+		const std::string_view d = domain(pending[i]);
+
+		uint64_t hash = HASH_BASIS;
+		for (std::size_t j = d.size(); j-- > 0;)
+			hash = HashStep(hash, d[j]);
+
+		Slot slot{static_cast<uint32_t>(hash >> 32), static_cast<uint32_t>(unique.size()),
+		          static_cast<uint32_t>(postings.size()), 0};
+		unique.append(d);
+		unique.push_back('\0');
+
+		for (; i < pending.size() && domain(pending[i]) == d; i++)
+		{
+			if (!slot.count || postings.back() != pending[i].set)
+			{
+				postings.push_back(pending[i].set);
+				slot.count++;
+			}
+		}
+
+		uint64_t position = hash & mask;
+		while (table[position].count)
+			position = (position + 1) & mask;
+		table[position] = slot;
+	}
+
+	domains.swap(unique);
+	domains.shrink_to_fit();
+	postings.shrink_to_fit();
+	pending.clear();
+	pending.shrink_to_fit();
+}
+
+int Proofpoint::DomainSets::Find(std::string_view name) const
+{
+	const auto it = std::find(names.begin(), names.end(), name);
+	return (it == names.end()) ? -1 : static_cast<int>(it - names.begin());
+}
+
+bool Proofpoint::DomainSets::Equals(const Slot& slot, std::string_view suffix) const
+{
+	const char* d = domains.data() + slot.offset;
+	for (const char c : suffix)
+	{
+		// A null in the value would run past the domain's terminator
+		if (c == '\0' || *d++ != Utils::ascii_lower(c))
+			return false;
+	}
+	return *d == '\0';
+}
+
+void Proofpoint::DomainSets::Lookup(std::string_view domain, std::vector<int>& ids) const
+{
+	if (table.empty())
+		return;
+
+	if (domain.ends_with('.'))
+		domain.remove_suffix(1);
+
+	uint64_t hash = HASH_BASIS;
+	for (std::size_t i = domain.size(); i-- > 0;)
+	{
+		hash = HashStep(hash, Utils::ascii_lower(domain[i]));
+		if (i > 0 && domain[i - 1] != '.')
+			continue;
+
+		// The labels from i onwards form a suffix, probe it
+		const std::string_view suffix = domain.substr(i);
+		for (uint64_t position = hash & mask; table[position].count; position = (position + 1) & mask)
+		{
+			const Slot& slot = table[position];
+			if (slot.hash == static_cast<uint32_t>(hash >> 32) && Equals(slot, suffix))
+			{
+				ids.insert(ids.end(), postings.begin() + slot.postings, postings.begin() + slot.postings + slot.count);
+				break;
+			}
+		}
+	}
+}
+
+std::size_t Proofpoint::DomainSets::MemoryUsage() const
+{
+	std::size_t usage = domains.capacity() + table.capacity() * sizeof(Slot) + postings.capacity() * sizeof(int);
+	for (const auto& name : names)
+		usage += name.capacity();
+	return usage;
+}
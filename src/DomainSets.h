@@ -0,0 +1,85 @@
+/**
+ * This code was tested against C++20
+ *
+ * @author Ludvik Jerabek
+ * @package slanalyzer
+ * @version 1.0.0
+ * @license MIT
+ */
+#ifndef SLANALYZER_DOMAINSETS_H
+#define SLANALYZER_DOMAINSETS_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Proofpoint
+{
+	// Domain sets referenced by is_in_domainset entries, indexed together. Every domain of
+	// every set lives in one open addressing table keyed by the lowercase domain. A value is
+	// hashed from its last label backwards and the table probed at each label boundary, so
+	// mail.example.com costs three probes (com, example.com, mail.example.com) however many
+	// sets and domains are loaded.
+	class DomainSets
+	{
+	public:
+		// Reads set name from file, one domain per line. Blank lines and lines starting with #
+		// are skipped, a leading "*." or "." and a trailing "." are dropped since every domain
+		// matches its subdomains anyway. False with error set when the file can't be read.
+		bool Load(const std::string& name, const std::string& file, std::string& error);
+		// Builds the index once every set is loaded, the sets are read only afterwards
+		void Build();
+
+		// Id of a loaded set, -1 when name wasn't loaded
+		[[nodiscard]] int Find(std::string_view name) const;
+		// Appends the id of every set holding domain or one of its parent domains, a set
+		// holding several of them is listed once for each
+		void Lookup(std::string_view domain, std::vector<int>& ids) const;
+
+		[[nodiscard]] std::size_t GetSetCount() const { return names.size(); }
+		[[nodiscard]] std::size_t GetDomainCount() const { return domain_count; }
+		[[nodiscard]] std::size_t MemoryUsage() const;
+
+	private:
+		struct Slot
+		{
+			uint32_t hash;
+			// Domain in domains, terminated by a null
+			uint32_t offset;
+			uint32_t postings;
+			uint32_t count; // Zero marks an empty slot
+		};
+
+		struct Pending
+		{
+			uint32_t offset;
+			uint32_t length;
+			int set;
+		};
+
+		// FNV-1a over the domain read backwards, a suffix's hash is a prefix of the walk
+		static constexpr uint64_t HASH_BASIS = 0xCBF29CE484222325ULL;
+		static constexpr uint64_t HASH_PRIME = 0x100000001B3ULL;
+
+		static uint64_t HashStep(uint64_t hash, char c)
+		{
+			return (hash ^ static_cast<unsigned char>(c)) * HASH_PRIME;
+		}
+
+		bool Equals(const Slot& slot, std::string_view suffix) const;
+
+	private:
+		std::vector<std::string> names;
+		// Lowercase domains back to back, each followed by a null
+		std::string domains;
+		// Domain and set of each line until the index is built
+		std::vector<Pending> pending;
+		std::size_t domain_count = 0;
+		std::vector<Slot> table;
+		uint64_t mask = 0;
+		// Sets of each domain
+		std::vector<int> postings;
+	};
+}
+#endif //SLANALYZER_DOMAINSETS_H
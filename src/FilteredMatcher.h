@@ -0,0 +1,276 @@
+/**
+ * This code was tested against C++20
+ *
+ * @author Ludvik Jerabek
+ * @package slanalyzer
+ * @version 1.0.0
+ * @license MIT
+ */
+#ifndef SLANALYZER_FILTEREDMATCHER_H
+#define SLANALYZER_FILTEREDMATCHER_H
+
+#include "IMatcher.h"
+#include "Matcher.h"
+#include "AhoCorasickMatcher.h"
+#include "re2/filtered_re2.h"
+#include "re2/re2.h"
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Proofpoint
+{
+	// Case-insensitive unanchored regexes behind a literal prefilter, a drop in replacement
+	// for Matcher(false, false, RE2::UNANCHORED).
+	//
+	// FilteredRE2 pulls the literals (atoms) out of each regex which any match must contain,
+	// .*@(mail|smtp)\.vendor\.com can't match without mail.vendor.com or smtp.vendor.com. A
+	// row looks for the atoms of every regex at once with the Aho-Corasick automaton and only
+	// runs the regexes whose atoms turned up, most rows run none at all. Patterns without
+	// atoms of at least MIN_ATOM_LENGTH characters stay in an RE2 set every row runs.
+	//
+	// Below MIN_FILTERED_PATTERNS every pattern stays in the set, whose DFA still fits its
+	// cache and beats running the regexes let through one by one. Add only keeps the
+	// patterns, which way they go is decided by Compile once their number is known.
+	template <typename T>
+	class FilteredMatcher final : public IMatcher<T>
+	{
+	public:
+		// max_mem is the budget of each RE2 set as in Matcher, the filtered regexes share one
+		explicit FilteredMatcher(std::int64_t max_mem = Matcher<T>::DEFAULT_MAX_MEM)
+			: unfiltered(false, false, RE2::UNANCHORED, max_mem)
+		{
+			opt.set_case_sensitive(false);
+			opt.set_log_errors(false);
+			opt.set_max_mem(max_mem);
+		}
+
+	public:
+		void Add(const std::string& pattern, const T& index, PatternErrors<T>& pattern_errors) override;
+		void Compile(PatternErrors<T>& pattern_errors) override;
+		bool Match(std::string_view pattern, std::vector<T>& match_indexes, MatchScratch<T>& scratch) const override;
+		std::size_t GetPatternCount() const override;
+		std::vector<T> GetPatternIndexes() const override;
+
+		// See IMatcher::Match, the regexes the atoms let through still match text
+		bool MatchAscii(std::string_view text, std::string_view lower, std::vector<T>& match_indexes,
+		                MatchScratch<T>& scratch) const;
+
+		void GetRegexStat(RegexStat& stat) const override
+		{
+			unfiltered.GetRegexStat(stat);
+		}
+
+	private:
+		// Shorter atoms would let too many rows through to the regexes
+		static constexpr int MIN_ATOM_LENGTH = 3;
+		static constexpr std::size_t MIN_FILTERED_PATTERNS = 512;
+		// The filtered regexes split the budget of a set. RE2 only allocates DFA states as a
+		// regex needs them, a regex short of memory searches with the NFA instead and one too
+		// large for its share gets the whole budget.
+		static constexpr std::int64_t MIN_REGEX_MEM = 65536;
+
+		void Build(PatternErrors<T>& pattern_errors);
+		// Adds the atoms which let regex id through to the automaton, false when it has none
+		bool AddAtoms(std::size_t id, PatternErrors<T>& pattern_errors);
+		// Replaces the regexes whose atoms were found in match_indexes with the entries of
+		// those which match text
+		void MatchCandidates(std::string_view text, std::vector<T>& match_indexes, MatchScratch<T>& scratch) const;
+
+	private:
+		std::once_flag built;
+		RE2::Options opt;
+		// Patterns and entries as added, released once built
+		std::vector<std::pair<std::string, T>> pending;
+		std::vector<std::unique_ptr<RE2>> regexes;
+		// Entry of each regex
+		std::vector<T> map_to_list_entry;
+		// Atoms which let each regex through, a pattern's index is its regex
+		AhoCorasickMatcher<T> atoms;
+		Matcher<T> unfiltered;
+	};
+
+	template <typename T>
+	void FilteredMatcher<T>::Add(const std::string& pattern, const T& index, PatternErrors<T>&)
+	{
+		pending.emplace_back(pattern, index);
+	}
+
+	template <typename T>
+	bool FilteredMatcher<T>::AddAtoms(std::size_t id, PatternErrors<T>& pattern_errors)
+	{
+		// A tree of its own gives the atoms of this regex alone
+		re2::FilteredRE2 prefilter(MIN_ATOM_LENGTH);
+		std::vector<std::string> strings;
+		int unused = 0;
+		prefilter.Add(regexes[id]->pattern(), opt, &unused);
+		prefilter.Compile(&strings);
+		if (strings.empty())
+			return false;
+
+		// The prefilter is an AND / OR tree of atoms. An atom whose absence alone rules the
+		// regex out is required and enough to look for, the longest is the least common.
+		// Without one, as in mail.vendor.com|smtp.vendor.com, any of the atoms lets it through.
+		std::size_t required = strings.size();
+		std::vector<int> others;
+		std::vector<int> potentials;
+		for (std::size_t i = 0; i < strings.size(); i++)
+		{
+			others.clear();
+			for (std::size_t j = 0; j < strings.size(); j++)
+			{
+				if (j != i)
+					others.push_back(static_cast<int>(j));
+			}
+			prefilter.AllPotentials(others, &potentials);
+			if (potentials.empty() && (required == strings.size() || strings[i].size() > strings[required].size()))
+				required = i;
+		}
+
+		if (required != strings.size())
+		{
+			atoms.Add(strings[required], static_cast<T>(id), pattern_errors);
+			return true;
+		}
+		for (const auto& atom : strings)
+		{
+			atoms.Add(atom, static_cast<T>(id), pattern_errors);
+		}
+		return true;
+	}
+
+	template <typename T>
+	void FilteredMatcher<T>::Build(PatternErrors<T>& pattern_errors)
+	{
+		if (pending.size() < MIN_FILTERED_PATTERNS)
+		{
+			for (const auto& [pattern, index] : pending)
+			{
+				unfiltered.Add(pattern, index, pattern_errors);
+			}
+		}
+		else
+		{
+			RE2::Options shared = opt;
+			shared.set_max_mem(std::max(opt.max_mem() / static_cast<std::int64_t>(pending.size()), MIN_REGEX_MEM));
+
+			for (const auto& [pattern, index] : pending)
+			{
+				auto regex = std::make_unique<RE2>(pattern, shared);
+				if (regex->error_code() == RE2::ErrorPatternTooLarge)
+				{
+					regex = std::make_unique<RE2>(pattern, opt);
+				}
+				if (!regex->ok())
+				{
+					pattern_errors.push_back({index, pattern, regex->error()});
+					continue;
+				}
+
+				regexes.push_back(std::move(regex));
+				map_to_list_entry.push_back(index);
+				if (!AddAtoms(regexes.size() - 1, pattern_errors))
+				{
+					regexes.pop_back();
+					map_to_list_entry.pop_back();
+					unfiltered.Add(pattern, index, pattern_errors);
+				}
+			}
+			atoms.Compile(pattern_errors);
+		}
+
+		if (unfiltered.GetPatternCount())
+		{
+			unfiltered.Compile(pattern_errors);
+		}
+		pending.clear();
+		pending.shrink_to_fit();
+	}
+
+	template <typename T>
+	void FilteredMatcher<T>::Compile(PatternErrors<T>& pattern_errors)
+	{
+		std::call_once(built, [this, &pattern_errors] { Build(pattern_errors); });
+	}
+
+	template <typename T>
+	void FilteredMatcher<T>::MatchCandidates(std::string_view text, std::vector<T>& match_indexes,
+	                                         MatchScratch<T>& scratch) const
+	{
+		std::vector<int>& candidates = scratch.candidates;
+		candidates.assign(match_indexes.begin(), match_indexes.end());
+		match_indexes.clear();
+
+		// A regex let through by several atoms runs once
+		std::sort(candidates.begin(), candidates.end());
+		candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+		for (int id : candidates)
+		{
+			if (regexes[id]->Match(text, 0, text.size(), RE2::UNANCHORED, nullptr, 0))
+			{
+				match_indexes.push_back(map_to_list_entry[id]);
+			}
+		}
+	}
+
+	template <typename T>
+	bool FilteredMatcher<T>::Match(std::string_view pattern, std::vector<T>& match_indexes,
+	                               MatchScratch<T>& scratch) const
+	{
+		// The regexes whose atoms were found are collected into match_indexes first and
+		// replaced by the entries of those which match
+		match_indexes.clear();
+		if (!regexes.empty() && atoms.Match(pattern, match_indexes, scratch))
+		{
+			MatchCandidates(pattern, match_indexes, scratch);
+		}
+
+		if (unfiltered.GetPatternCount())
+		{
+			unfiltered.Match(pattern, scratch.indexes, scratch);
+			match_indexes.insert(match_indexes.end(), scratch.indexes.begin(), scratch.indexes.end());
+		}
+
+		return !match_indexes.empty();
+	}
+
+	template <typename T>
+	bool FilteredMatcher<T>::MatchAscii(std::string_view text, std::string_view lower,
+	                                    std::vector<T>& match_indexes, MatchScratch<T>& scratch) const
+	{
+		match_indexes.clear();
+		if (!regexes.empty() && atoms.MatchAscii(text, lower, match_indexes, scratch))
+		{
+			MatchCandidates(text, match_indexes, scratch);
+		}
+
+		if (unfiltered.GetPatternCount())
+		{
+			unfiltered.MatchAscii(text, lower, scratch.indexes, scratch);
+			match_indexes.insert(match_indexes.end(), scratch.indexes.begin(), scratch.indexes.end());
+		}
+
+		return !match_indexes.empty();
+	}
+
+	template <typename T>
+	std::vector<T> FilteredMatcher<T>::GetPatternIndexes() const
+	{
+		std::vector<T> indexes = map_to_list_entry;
+
+		// Empty when the unfiltered set failed to compile, it never matches then
+		std::vector<T> rest = unfiltered.GetPatternIndexes();
+		indexes.insert(indexes.end(), rest.begin(), rest.end());
+		return indexes;
+	}
+
+	template <typename T>
+	std::size_t FilteredMatcher<T>::GetPatternCount() const
+	{
+		// Patterns added until Compile sorts them out
+		return pending.size() + map_to_list_entry.size() + unfiltered.GetPatternCount();
+	}
+}
+#endif //SLANALYZER_FILTEREDMATCHER_H
@@ -7,55 +7,218 @@
  * @license MIT
  */
 #include "GlobalAddressMatcher.h"
-#include "Matcher.h"
-#include "InvertedMatcher.h"
-#include "SubnetMatcher.h"
-#include "InvertedSubnetMatcher.h"
-
-Proofpoint::GlobalAddressMatcher::GlobalAddressMatcher() :
-	matchers({
-		{GlobalList::MatchType::EQUAL, std::make_shared<Matcher<std::size_t>>(true, false, RE2::ANCHOR_BOTH)},
-		{
-			GlobalList::MatchType::NOT_EQUAL,
-			std::make_shared<InvertedMatcher<std::size_t>>(true, false, RE2::ANCHOR_BOTH)
-		},
-		{GlobalList::MatchType::MATCH, std::make_shared<Matcher<std::size_t>>(true, false, RE2::UNANCHORED)},
-		{
-			GlobalList::MatchType::NOT_MATCH,
-			std::make_shared<InvertedMatcher<std::size_t>>(true, false, RE2::UNANCHORED)
-		},
-		{GlobalList::MatchType::REGEX, std::make_shared<Matcher<std::size_t>>(false, false, RE2::UNANCHORED)},
-		{
-			GlobalList::MatchType::NOT_REGEX,
-			std::make_shared<InvertedMatcher<std::size_t>>(false, false, RE2::UNANCHORED)
-		},
-		{GlobalList::MatchType::IP_IN_NET, std::make_shared<SubnetMatcher<std::size_t>>()},
-		{GlobalList::MatchType::IP_NOT_IN_NET, std::make_shared<InvertedSubnetMatcher<std::size_t>>()}
-	})
+
+Proofpoint::GlobalAddressMatcher::GlobalAddressMatcher(SubnetSet::Layout layout, std::int64_t regex_mem) :
+	prefix(AffixMatcher<std::size_t>::Side::PREFIX),
+	not_prefix(AffixMatcher<std::size_t>::Side::PREFIX),
+	suffix(AffixMatcher<std::size_t>::Side::SUFFIX),
+	not_suffix(AffixMatcher<std::size_t>::Side::SUFFIX),
+	regex(regex_mem),
+	not_regex(regex_mem),
+	in_net(layout),
+	not_in_net(layout),
+	matchers{},
+	active(0)
 {
+	matchers[static_cast<std::size_t>(GlobalList::MatchType::EQUAL)] = &equal;
+	matchers[static_cast<std::size_t>(GlobalList::MatchType::NOT_EQUAL)] = &not_equal;
+	matchers[static_cast<std::size_t>(GlobalList::MatchType::MATCH)] = &match;
+	matchers[static_cast<std::size_t>(GlobalList::MatchType::NOT_MATCH)] = &not_match;
+	matchers[static_cast<std::size_t>(GlobalList::MatchType::REGEX)] = &regex;
+	matchers[static_cast<std::size_t>(GlobalList::MatchType::NOT_REGEX)] = &not_regex;
+	matchers[static_cast<std::size_t>(GlobalList::MatchType::IP_IN_NET)] = &in_net;
+	matchers[static_cast<std::size_t>(GlobalList::MatchType::IP_NOT_IN_NET)] = &not_in_net;
+	matchers[EQUAL_IP] = &equal_ip;
+	matchers[NOT_EQUAL_IP] = &not_equal_ip;
+	matchers[PREFIX] = &prefix;
+	matchers[NOT_PREFIX] = &not_prefix;
+	matchers[SUFFIX] = &suffix;
+	matchers[NOT_SUFFIX] = &not_suffix;
+}
+
+template <typename Fn>
+void Proofpoint::GlobalAddressMatcher::Visit(Fn&& fn) const
+{
+	// Expanded per engine so Match and IsInverted bind statically, empty engines are skipped
+	// with a single test of the mask
+	auto visit = [this, &fn](std::size_t slot, const auto& engine)
+	{
+		if (active & (1u << slot))
+			fn(slot, engine);
+	};
+	visit(static_cast<std::size_t>(GlobalList::MatchType::EQUAL), equal);
+	visit(static_cast<std::size_t>(GlobalList::MatchType::NOT_EQUAL), not_equal);
+	visit(static_cast<std::size_t>(GlobalList::MatchType::MATCH), match);
+	visit(static_cast<std::size_t>(GlobalList::MatchType::NOT_MATCH), not_match);
+	visit(PREFIX, prefix);
+	visit(NOT_PREFIX, not_prefix);
+	visit(SUFFIX, suffix);
+	visit(NOT_SUFFIX, not_suffix);
+	visit(static_cast<std::size_t>(GlobalList::MatchType::REGEX), regex);
+	visit(static_cast<std::size_t>(GlobalList::MatchType::NOT_REGEX), not_regex);
+	visit(static_cast<std::size_t>(GlobalList::MatchType::IP_IN_NET), in_net);
+	visit(static_cast<std::size_t>(GlobalList::MatchType::IP_NOT_IN_NET), not_in_net);
+	visit(EQUAL_IP, equal_ip);
+	visit(NOT_EQUAL_IP, not_equal_ip);
 }
 
 void Proofpoint::GlobalAddressMatcher::Add(GlobalList::MatchType type, const std::string& pattern,
                                            const std::size_t& index, PatternErrors<std::size_t>& pattern_errors)
 {
-	if (type == GlobalList::MatchType::IS_IN_DOMAINSET || type == GlobalList::MatchType::UNKNOWN) return;
-	matchers[type]->Add(pattern, index, pattern_errors);
+	if (type == GlobalList::MatchType::IS_IN_DOMAINSET)
+	{
+		pattern_errors.push_back({index, pattern, "Domain sets match domains, $ip has none"});
+		return;
+	}
+
+	std::size_t slot = static_cast<std::size_t>(type);
+	const std::string* added = &pattern;
+	if (IpAddress::Parse(pattern).family == IpAddress::Family::V4)
+	{
+		if (type == GlobalList::MatchType::EQUAL)
+			slot = EQUAL_IP;
+		else if (type == GlobalList::MatchType::NOT_EQUAL)
+			slot = NOT_EQUAL_IP;
+	}
+
+	// A regex which is a literal goes to the engine looking that literal up. An exact one
+	// compares text as the regex did, the address engines would also take ::ffff:10.0.0.1
+	// for 10.0.0.1.
+	RegexLiteral literal;
+	if (type == GlobalList::MatchType::REGEX || type == GlobalList::MatchType::NOT_REGEX)
+	{
+		literal = RegexLiteral::Parse(pattern);
+		const bool inverted = type == GlobalList::MatchType::NOT_REGEX;
+		switch (literal.form)
+		{
+		case RegexLiteral::Form::EXACT:
+			slot = static_cast<std::size_t>(inverted ? GlobalList::MatchType::NOT_EQUAL : GlobalList::MatchType::EQUAL);
+			break;
+		case RegexLiteral::Form::SUBSTRING:
+			slot = static_cast<std::size_t>(inverted ? GlobalList::MatchType::NOT_MATCH : GlobalList::MatchType::MATCH);
+			break;
+		case RegexLiteral::Form::PREFIX: slot = inverted ? NOT_PREFIX : PREFIX;
+			break;
+		case RegexLiteral::Form::SUFFIX: slot = inverted ? NOT_SUFFIX : SUFFIX;
+			break;
+		case RegexLiteral::Form::NONE: break;
+		}
+		if (literal.form != RegexLiteral::Form::NONE)
+		{
+			added = &literal.literal;
+			demoted++;
+		}
+	}
+
+	IMatcher<std::size_t>* matcher = matchers[slot];
+	if (!matcher) return;
+	matcher->Add(*added, index, pattern_errors);
+	if (matcher->GetPatternCount())
+		active |= 1u << slot;
 }
 
-bool Proofpoint::GlobalAddressMatcher::Match(bool inbound, const std::string& pattern, GlobalList::Entries& safe_list)
+bool Proofpoint::GlobalAddressMatcher::Match(bool inbound, std::string_view pattern, GlobalList::Counters& counters,
+                                             GlobalList::Counter& evaluated, MatchScratch<std::size_t>& scratch,
+                                             Batch& batch) const
 {
+	std::vector<std::size_t>& match_indexes = scratch.matches;
 	bool matched = false;
-	std::vector<std::size_t> match_indexes;
-	for (auto m : matchers)
+	bool deferred = false;
+	// Parsed once for every engine which works on the address, lowered once for those
+	// which work on the text
+	const IpAddress address = IpAddress::Parse(pattern);
+	const bool ascii = Utils::ascii_lower_copy(pattern, scratch.lower);
+	const std::string_view lower = scratch.lower;
+	Visit([&](std::size_t, const auto& engine)
 	{
-		if (m.second->GetPatternCount())
+		if constexpr (requires { engine.MatchBatch(batch.addresses, scratch.offsets, match_indexes, scratch); })
 		{
-			matched |= m.second->Match(pattern, match_indexes);
-			for (auto i : match_indexes)
+			if (address.family == IpAddress::Family::V4)
 			{
-				(inbound) ? safe_list[i].inbound++ : safe_list[i].outbound++;
+				deferred = true;
+				return;
 			}
 		}
+
+		if constexpr (requires { engine.Match(address, match_indexes, scratch); })
+			matched |= engine.Match(address, match_indexes, scratch);
+		else
+			matched |= MatchValue(engine, pattern, ascii, lower, match_indexes, scratch);
+		GlobalList::Count(inbound, engine.IsInverted(), match_indexes, counters);
+	});
+	(inbound) ? evaluated.inbound++ : evaluated.outbound++;
+
+	if (deferred)
+	{
+		batch.addresses.push_back(address.v4);
+		batch.inbound.push_back(inbound);
+		if (batch.addresses.size() >= BATCH_SIZE)
+			Flush(batch, counters, scratch);
 	}
 	return matched;
 }
+
+void Proofpoint::GlobalAddressMatcher::Flush(Batch& batch, GlobalList::Counters& counters,
+                                             MatchScratch<std::size_t>& scratch) const
+{
+	if (batch.addresses.empty())
+		return;
+
+	const std::vector<std::size_t>& match_indexes = scratch.matches;
+	const std::vector<uint32_t>& offsets = scratch.offsets;
+	Visit([&](std::size_t, const auto& engine)
+	{
+		if constexpr (requires { engine.MatchBatch(batch.addresses, scratch.offsets, scratch.matches, scratch); })
+		{
+			engine.MatchBatch(batch.addresses, scratch.offsets, scratch.matches, scratch);
+			for (std::size_t i = 0; i < batch.addresses.size(); i++)
+			{
+				GlobalList::Count(batch.inbound[i], engine.IsInverted(),
+				                  std::span(match_indexes).subspan(offsets[i], offsets[i + 1] - offsets[i]), counters);
+			}
+		}
+	});
+	batch.addresses.clear();
+	batch.inbound.clear();
+}
+
+void Proofpoint::GlobalAddressMatcher::Finalize(const GlobalList::Counter& evaluated,
+                                                GlobalList::Counters& counters) const
+{
+	if (!evaluated.inbound && !evaluated.outbound)
+		return;
+
+	Visit([&](std::size_t, const auto& engine)
+	{
+		if (engine.IsInverted())
+			GlobalList::Finalize(evaluated, engine.GetPatternIndexes(), counters);
+	});
+}
+
+std::size_t Proofpoint::GlobalAddressMatcher::GetPatternCount() const
+{
+	std::size_t count = 0;
+	Visit([&count](std::size_t, const auto& engine)
+	{
+		count += engine.GetPatternCount();
+	});
+	return count;
+}
+
+void Proofpoint::GlobalAddressMatcher::GetRegexStat(RegexStat& stat) const
+{
+	Visit([&stat](std::size_t, const auto& engine)
+	{
+		engine.GetRegexStat(stat);
+	});
+}
+
+std::vector<Proofpoint::IMatcher<std::size_t>*> Proofpoint::GlobalAddressMatcher::GetMatchers()
+{
+	std::vector<IMatcher<std::size_t>*> result;
+	Visit([this, &result](std::size_t slot, const auto&)
+	{
+		result.push_back(matchers[slot]);
+	});
+	return result;
+}
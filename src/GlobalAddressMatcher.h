@@ -11,23 +11,101 @@
 
 #include "IMatcher.h"
 #include "GlobalList.h"
+#include "Matcher.h"
+#include "HashMatcher.h"
+#include "AhoCorasickMatcher.h"
+#include "AffixMatcher.h"
+#include "FilteredMatcher.h"
+#include "SubnetMatcher.h"
+#include "IpMatcher.h"
+#include "InvertedMatcher.h"
+#include "RegexLiteral.h"
 #include "Subnet.h"
 #include "Utils.h"
-#include <unordered_map>
+#include <array>
+#include <cstdint>
 
 namespace Proofpoint
 {
 	class GlobalAddressMatcher
 	{
 	public:
-		GlobalAddressMatcher();
+		// IPv4 senders whose subnet lookups wait to be done together, owned by the calling thread
+		struct Batch
+		{
+			std::vector<uint32_t> addresses;
+			std::vector<bool> inbound;
+		};
+
+		// Senders a batch collects before its lookups run, enough for the cache misses of a
+		// block to overlap while the tables touched stay cached
+		static constexpr std::size_t BATCH_SIZE = 512;
+
+	public:
+		// regex_mem is the memory each RE2 set of the regex entries may use, see Matcher
+		explicit GlobalAddressMatcher(SubnetSet::Layout layout = SubnetSet::Layout::POPTRIE,
+		                              std::int64_t regex_mem = Matcher<std::size_t>::DEFAULT_MAX_MEM);
 		~GlobalAddressMatcher() = default;
 		void Add(GlobalList::MatchType type, const std::string& pattern, const std::size_t& index,
 		         PatternErrors<std::size_t>& pattern_error);
-		bool Match(bool inbound, const std::string& pattern, GlobalList::Entries& safe_list);
+		// The subnet lookups of an IPv4 sender are deferred into batch, their matches are only
+		// counted once it fills or Flush is called and don't take part in the result
+		bool Match(bool inbound, std::string_view pattern, GlobalList::Counters& counters,
+		           GlobalList::Counter& evaluated, MatchScratch<std::size_t>& scratch, Batch& batch) const;
+
+		// Runs and counts the subnet lookups waiting in batch, call once the rows are done
+		void Flush(Batch& batch, GlobalList::Counters& counters, MatchScratch<std::size_t>& scratch) const;
+
+		// Counts the entries of inverted matchers for every value evaluated, see IMatcher::IsInverted
+		void Finalize(const GlobalList::Counter& evaluated, GlobalList::Counters& counters) const;
+
+		std::size_t GetPatternCount() const;
+		// Regex entries which turned out to be literals and went to a literal engine
+		std::size_t GetDemotedCount() const { return demoted; }
+
+		// Adds the RE2 sets of every engine to stat
+		void GetRegexStat(RegexStat& stat) const;
+
+		// Matchers holding patterns, each can be compiled on its own thread
+		std::vector<IMatcher<std::size_t>*> GetMatchers();
+
+	private:
+		// Calls fn(slot, engine) with the concrete type of every engine holding patterns
+		template <typename Fn>
+		void Visit(Fn&& fn) const;
+
+		// Slots past the match types, for equal and not_equal entries whose pattern is an IPv4
+		// address. Those are compared with the parsed Sender_IP_Address instead of its text.
+		static constexpr std::size_t EQUAL_IP = GlobalList::MATCH_TYPE_COUNT;
+		static constexpr std::size_t NOT_EQUAL_IP = EQUAL_IP + 1;
+		// For regex and not_regex entries which are a literal the value starts or ends with,
+		// see GlobalStringMatcher
+		static constexpr std::size_t PREFIX = NOT_EQUAL_IP + 1;
+		static constexpr std::size_t NOT_PREFIX = PREFIX + 1;
+		static constexpr std::size_t SUFFIX = NOT_PREFIX + 1;
+		static constexpr std::size_t NOT_SUFFIX = SUFFIX + 1;
 
 	private:
-		std::unordered_map<GlobalList::MatchType, std::shared_ptr<IMatcher<std::size_t>>> matchers;
+		// Engine of each match type, the row path calls them by their concrete type
+		HashMatcher<std::size_t> equal;
+		InvertedMatcher<std::size_t, HashMatcher<std::size_t>> not_equal;
+		IpMatcher<std::size_t> equal_ip;
+		InvertedMatcher<std::size_t, IpMatcher<std::size_t>> not_equal_ip;
+		AhoCorasickMatcher<std::size_t> match;
+		InvertedMatcher<std::size_t, AhoCorasickMatcher<std::size_t>> not_match;
+		AffixMatcher<std::size_t> prefix;
+		InvertedMatcher<std::size_t, AffixMatcher<std::size_t>> not_prefix;
+		AffixMatcher<std::size_t> suffix;
+		InvertedMatcher<std::size_t, AffixMatcher<std::size_t>> not_suffix;
+		FilteredMatcher<std::size_t> regex;
+		InvertedMatcher<std::size_t, FilteredMatcher<std::size_t>> not_regex;
+		SubnetMatcher<std::size_t> in_net;
+		InvertedMatcher<std::size_t, SubnetMatcher<std::size_t>> not_in_net;
+		// The engines above indexed by slot for loading, null where a match type has none
+		std::array<IMatcher<std::size_t>*, NOT_SUFFIX + 1> matchers;
+		// Bit of each slot holding patterns
+		std::uint32_t active;
+		std::size_t demoted = 0;
 	};
 }
 #endif //SLANALYZER_ADDRESSMATCHER_H
@@ -8,17 +8,72 @@
  */
 
 #include "GlobalAnalyzer.h"
-#include "CsvParser.h"
+#include "ParallelCsvParser.h"
+#include <algorithm>
 #include <chrono>
 #include "re2/re2.h"
 #include "Utils.h"
+#include "Memory.h"
+#include "HeaderFrom.h"
+#include <filesystem>
 #include <iostream>
 
-void Proofpoint::GlobalAnalyzer::Load(const GlobalList& safelist, PatternErrors<std::size_t>& pattern_errors)
+void Proofpoint::GlobalAnalyzer::LoadDomainSets(const GlobalList& safelist,
+                                                std::unordered_map<std::string, std::string>& errors)
 {
+	for (const auto& entry : safelist)
+	{
+		// $ip has no domain to look up, GlobalAddressMatcher reports those entries
+		if (entry.match_type != GlobalList::MatchType::IS_IN_DOMAINSET ||
+			entry.field_type == GlobalList::FieldType::IP || entry.field_type == GlobalList::FieldType::UNKNOWN)
+			continue;
+
+		const std::string name = Utils::trim_copy(entry.pattern);
+		if (domain_sets.Find(name) != -1 || errors.contains(name))
+			continue;
+
+		if (domain_set_path.empty())
+		{
+			errors[name] = "Domain set [" + name + "] needs a domain set directory, see --domainsets";
+			continue;
+		}
+
+		std::filesystem::path file = std::filesystem::path(domain_set_path) / name;
+		if (!std::filesystem::exists(file))
+			file += ".txt";
+
+		std::string error;
+		if (!domain_sets.Load(name, file.string(), error))
+			errors[name] = error;
+	}
+	domain_sets.Build();
+}
+
+void Proofpoint::GlobalAnalyzer::Load(const GlobalList& safelist, PatternErrors<std::size_t>& pattern_errors,
+                                      CompileStats& compile_stats, std::size_t threads)
+{
+	auto domain_sets_start = std::chrono::steady_clock::now();
+	std::unordered_map<std::string, std::string> domain_set_errors;
+	LoadDomainSets(safelist, domain_set_errors);
+	const CompileStat domain_sets_stat{
+		"domainsets", domain_sets.GetDomainCount(),
+		std::chrono::duration<double>(std::chrono::steady_clock::now() - domain_sets_start).count(),
+		static_cast<std::int64_t>(domain_sets.MemoryUsage()), 0, true
+	};
+
 	for (auto sle = safelist.begin(); sle != safelist.end(); sle++)
 	{
 		std::size_t index = std::distance(safelist.begin(), sle);
+		if (sle->match_type == GlobalList::MatchType::IS_IN_DOMAINSET && sle->field_type != GlobalList::FieldType::IP)
+		{
+			auto error = domain_set_errors.find(Utils::trim_copy(sle->pattern));
+			if (error != domain_set_errors.end())
+			{
+				pattern_errors.push_back({index, sle->pattern, error->second});
+				continue;
+			}
+		}
+
 		switch (sle->field_type)
 		{
 		case GlobalList::FieldType::IP: ip.Add(sle->match_type, sle->pattern, index, pattern_errors);
@@ -36,18 +91,101 @@ void Proofpoint::GlobalAnalyzer::Load(const GlobalList& safelist, PatternErrors<
 		case GlobalList::FieldType::UNKNOWN: break;
 		}
 	}
+
+	// Every matcher of every field compiles independently, stats are added up per field
+	struct Task
+	{
+		std::size_t field;
+		IMatcher<std::size_t>* matcher;
+		PatternErrors<std::size_t> pattern_errors;
+		double seconds;
+		std::int64_t memory;
+	};
+
+	compile_stats = {
+		{GlobalList::GetFieldTypeString(GlobalList::FieldType::IP), ip.GetPatternCount(), 0, 0},
+		{GlobalList::GetFieldTypeString(GlobalList::FieldType::HOST), host.GetPatternCount(), 0, 0},
+		{GlobalList::GetFieldTypeString(GlobalList::FieldType::HELO), helo.GetPatternCount(), 0, 0},
+		{GlobalList::GetFieldTypeString(GlobalList::FieldType::HFROM), hfrom.GetPatternCount(), 0, 0},
+		{GlobalList::GetFieldTypeString(GlobalList::FieldType::FROM), from.GetPatternCount(), 0, 0},
+		{GlobalList::GetFieldTypeString(GlobalList::FieldType::RCPT), rcpt.GetPatternCount(), 0, 0},
+		domain_sets_stat
+	};
+	compile_stats[0].demoted = ip.GetDemotedCount();
+	compile_stats[1].demoted = host.GetDemotedCount();
+	compile_stats[2].demoted = helo.GetDemotedCount();
+	compile_stats[3].demoted = hfrom.GetDemotedCount();
+	compile_stats[4].demoted = from.GetDemotedCount();
+	compile_stats[5].demoted = rcpt.GetDemotedCount();
+
+	std::vector<Task> tasks;
+	auto add_tasks = [&tasks](std::size_t field, std::vector<IMatcher<std::size_t>*> matchers)
+	{
+		for (auto* matcher : matchers)
+			tasks.push_back({field, matcher, {}, 0, 0});
+	};
+	add_tasks(0, ip.GetMatchers());
+	add_tasks(1, host.GetMatchers());
+	add_tasks(2, helo.GetMatchers());
+	add_tasks(3, hfrom.GetMatchers());
+	add_tasks(4, from.GetMatchers());
+	add_tasks(5, rcpt.GetMatchers());
+
+	Utils::parallel_for(tasks.size(), threads, [&tasks](std::size_t i)
+	{
+		Task& task = tasks[i];
+		auto start = std::chrono::steady_clock::now();
+		auto memory = Memory::thread_allocated();
+		task.matcher->Compile(task.pattern_errors);
+		task.memory = Memory::thread_allocated() - memory;
+		task.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	});
+
+	// Patterns which failed to compile are reported as errors and no longer counted
+	compile_stats[0].patterns = ip.GetPatternCount();
+	compile_stats[1].patterns = host.GetPatternCount();
+	compile_stats[2].patterns = helo.GetPatternCount();
+	compile_stats[3].patterns = hfrom.GetPatternCount();
+	compile_stats[4].patterns = from.GetPatternCount();
+	compile_stats[5].patterns = rcpt.GetPatternCount();
+	for (const auto& task : tasks)
+	{
+		compile_stats[task.field].seconds += task.seconds;
+		compile_stats[task.field].memory += task.memory;
+		pattern_errors.insert(pattern_errors.end(), task.pattern_errors.begin(), task.pattern_errors.end());
+	}
+
+	// Regexes are only parsed by Compile, errors are listed in the order of the list
+	std::stable_sort(pattern_errors.begin(), pattern_errors.end(), [](const auto& a, const auto& b)
+	{
+		return a.index < b.index;
+	});
 }
 
-std::optional<std::size_t> Proofpoint::GlobalAnalyzer::Process(const std::string& ss_file, GlobalList& safelist,
-                                                               std::size_t& records_processed)
+std::optional<std::size_t> Proofpoint::GlobalAnalyzer::Process(const std::string& ss_file,
+                                                               GlobalList::Counters& counters,
+                                                               std::size_t& records_processed,
+                                                               std::size_t& row_allocations,
+                                                               std::size_t threads) const
 {
-	std::ifstream f(ss_file);
-	csv::CsvParser parser(f);
-	re2::StringPiece matches[2];
-	RE2 hfrom_addr_only(R"(<?\s*([a-zA-Z0-9.!#$%&’*+\/=?^_`{|}~-]+@[a-zA-Z0-9-]+(?:\.[a-zA-Z0-9-]+)*)\s*>?\s*(?:;|$))");
+	csv::MappedFile file(ss_file);
+	csv::MappedCsvParser parser(file.view());
+	HeaderFrom hfrom_addr_only;
 	RE2 inbound_check(R"(\bdefault_inbound\b)");
 
-	csv::HeaderMap header_map;
+	// Slots of the required headers in a projected row
+	enum Column : std::size_t
+	{
+		POLICY_ROUTE,
+		SENDER_IP_ADDRESS,
+		SENDER_HOST,
+		HELO,
+		HEADER_FROM,
+		SENDER,
+		RECIPIENTS
+	};
+
+	csv::Projection projection;
 	csv::HeaderList required_headers{
 		"Policy_Route",
 		"Sender_IP_Address",
@@ -59,31 +197,123 @@ std::optional<std::size_t> Proofpoint::GlobalAnalyzer::Process(const std::string
 	};
 
 	// Validate there are headers we are interested in...
-	auto header_index = parser.FindHeader(required_headers, header_map);
+	auto header_index = parser.FindHeader(required_headers, projection);
 
-	//std::cout << std::setw(35) << "Highest Index" << " " << std::setw(25) << header_index << std::endl;
-	// std::multimap is useful for CSVs where there may be duplicate headers.
-	//for (auto i = header_map.begin(); i!= header_map.end(); i++){
-	//	std::cout << std::setw(35) << i->first << " " << std::setw(25) << i->second  << " " << header_map.count(i->first) << std::endl;
-	//}
+	if (!header_index)
+		return header_index;
 
-	if (header_index)
-		for (auto& row : parser)
+	// Fields without patterns are never matched, which also drops the header from
+	// extraction and recipient splitting when nothing would look at the result
+	const bool match_ip = ip.GetPatternCount() > 0;
+	const bool match_host = host.GetPatternCount() > 0;
+	const bool match_helo = helo.GetPatternCount() > 0;
+	const bool match_hfrom = hfrom.GetPatternCount() > 0;
+	const bool match_from = from.GetPatternCount() > 0;
+	const bool match_rcpt = rcpt.GetPatternCount() > 0;
+	const bool match_any = match_ip || match_host || match_helo || match_hfrom || match_from || match_rcpt;
+
+	// Rows after the header are split across workers, each counting into its own
+	// counters which are added to the caller's once every range has been parsed
+	csv::ParallelCsvParser workers(file.view(), parser.position(), threads);
+	workers.project(projection);
+
+	// Everything a worker touches evaluating a row, the buffers keep their capacity so
+	// rows stop allocating once they have grown to fit
+	struct Context
+	{
+		GlobalList::Counters counters;
+		// Values each field evaluated, inverted entries are counted from these
+		GlobalList::Counter ip, host, helo, hfrom, from, rcpt;
+		MatchScratch<std::size_t> scratch;
+		GlobalAddressMatcher::Batch ip_batch;
+		std::vector<std::string_view> recipients;
+		std::size_t records;
+		std::uint64_t allocations;
+	};
+
+	std::vector<Context> contexts(workers.workers());
+	auto reset = [&counters](Context& context)
+	{
+		context.counters.assign(counters.size(), GlobalList::Counter{0, 0});
+		context.ip = context.host = context.helo = context.hfrom = context.from = context.rcpt = {0, 0};
+		context.ip_batch.addresses.clear();
+		context.ip_batch.inbound.clear();
+		context.records = 0;
+		context.allocations = 0;
+	};
+	for (auto& context : contexts)
+		reset(context);
+
+	workers.Run(
+		[&](std::size_t worker, const csv::MappedCsvParser::Row& row)
 		{
-			bool inbound = RE2::PartialMatch(row[header_map.find("Policy_Route")->second], inbound_check);
-			ip.Match(inbound, row[header_map.find("Sender_IP_Address")->second], safelist.entries);
-			host.Match(inbound, row[header_map.find("Sender_Host")->second], safelist.entries);
-			helo.Match(inbound, row[header_map.find("HELO")->second], safelist.entries);
-			// This single call has large impact on processing. Since we need to perform header from "address only"
-			hfrom.Match(inbound, (hfrom_addr_only.Match(row[header_map.find("Header_From")->second], 0,
-			                                            row[header_map.find("Header_From")->second].length(),
-			                                            RE2::UNANCHORED, matches, 2))
-				                     ? Utils::cvt_std_string(matches[1])
-				                     : row[header_map.find("Header_From")->second], safelist.entries);
-			from.Match(inbound, row[header_map.find("Sender")->second], safelist.entries);
-
-			rcpt.Match(inbound, Utils::split(row[header_map.find("Recipients")->second], ','), safelist.entries);
-			records_processed++;
-		}
+			// Short rows (blank lines, truncated exports) don't carry the fields we need
+			if (row.empty())
+				return;
+
+			Context& context = contexts[worker];
+			context.records++;
+
+			if (!match_any)
+				return;
+
+			const std::uint64_t allocations = Memory::thread_allocations();
+			GlobalList::Counters& counts = context.counters;
+			MatchScratch<std::size_t>& scratch = context.scratch;
+
+			bool inbound = RE2::PartialMatch(row[POLICY_ROUTE], inbound_check);
+			if (match_ip)
+				ip.Match(inbound, row[SENDER_IP_ADDRESS], counts, context.ip, scratch, context.ip_batch);
+			if (match_host)
+				host.Match(inbound, row[SENDER_HOST], counts, context.host, scratch);
+			if (match_helo)
+				helo.Match(inbound, row[HELO], counts, context.helo, scratch);
+			if (match_hfrom)
+				hfrom.Match(inbound, hfrom_addr_only.Extract(row[HEADER_FROM]), counts, context.hfrom, scratch);
+			if (match_from)
+				from.Match(inbound, row[SENDER], counts, context.from, scratch);
+			if (match_rcpt)
+			{
+				Utils::split(row[RECIPIENTS], ',', context.recipients);
+				rcpt.Match(inbound, context.recipients, counts, context.rcpt, scratch);
+			}
+			context.allocations += Memory::thread_allocations() - allocations;
+		},
+		[&](std::size_t worker)
+		{
+			reset(contexts[worker]);
+		});
+
+	for (auto& context : contexts)
+	{
+		ip.Flush(context.ip_batch, context.counters, context.scratch);
+		ip.Finalize(context.ip, context.counters);
+		host.Finalize(context.host, context.counters);
+		helo.Finalize(context.helo, context.counters);
+		hfrom.Finalize(context.hfrom, context.counters);
+		from.Finalize(context.from, context.counters);
+		rcpt.Finalize(context.rcpt, context.counters);
+		GlobalList::Merge(counters, context.counters);
+		records_processed += context.records;
+		row_allocations += context.allocations;
+	}
 	return header_index;
 }
+
+Proofpoint::RegexStats Proofpoint::GlobalAnalyzer::GetRegexStats() const
+{
+	RegexStats stats(6);
+	stats[0].name = GlobalList::GetFieldTypeString(GlobalList::FieldType::IP);
+	ip.GetRegexStat(stats[0]);
+	stats[1].name = GlobalList::GetFieldTypeString(GlobalList::FieldType::HOST);
+	host.GetRegexStat(stats[1]);
+	stats[2].name = GlobalList::GetFieldTypeString(GlobalList::FieldType::HELO);
+	helo.GetRegexStat(stats[2]);
+	stats[3].name = GlobalList::GetFieldTypeString(GlobalList::FieldType::HFROM);
+	hfrom.GetRegexStat(stats[3]);
+	stats[4].name = GlobalList::GetFieldTypeString(GlobalList::FieldType::FROM);
+	from.GetRegexStat(stats[4]);
+	stats[5].name = GlobalList::GetFieldTypeString(GlobalList::FieldType::RCPT);
+	rcpt.GetRegexStat(stats[5]);
+	return stats;
+}
@@ -12,6 +12,11 @@
 #include "GlobalList.h"
 #include "GlobalAddressMatcher.h"
 #include "GlobalStringMatcher.h"
+#include "DomainSets.h"
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
 
 namespace Proofpoint
 {
@@ -21,13 +26,41 @@ namespace Proofpoint
 		using PatternErrorMap = std::unordered_map<GlobalList::FieldType, PatternErrors<std::size_t>>;
 
 	public:
-		GlobalAnalyzer() = default;
+		// layout is how the CIDRs of ip_in_net and ip_not_in_net entries are looked up, the
+		// domain set an is_in_domainset entry names is read from domain_set_path/NAME or
+		// domain_set_path/NAME.txt and regex_mem is the memory each RE2 set may use
+		explicit GlobalAnalyzer(SubnetSet::Layout layout = SubnetSet::Layout::POPTRIE,
+		                        std::string domain_set_path = {},
+		                        std::int64_t regex_mem = Matcher<std::size_t>::DEFAULT_MAX_MEM)
+			: domain_set_path(std::move(domain_set_path)), ip(layout, regex_mem), host(domain_sets, regex_mem),
+			  helo(domain_sets, regex_mem), hfrom(domain_sets, regex_mem, true), from(domain_sets, regex_mem, true),
+			  rcpt(domain_sets, regex_mem, true)
+		{
+		}
 		~GlobalAnalyzer() = default;
-		void Load(const GlobalList& safelist, PatternErrors<std::size_t>& pattern_errors);
-		std::optional<std::size_t> Process(const std::string& ss_file, GlobalList& safelist,
-		                                   std::size_t& records_processed);
+		// Loads the domain sets the entries name, adds every entry and compiles the matchers
+		// on up to threads threads. Reading the domain sets is reported as its own stat.
+		void Load(const GlobalList& safelist, PatternErrors<std::size_t>& pattern_errors,
+		          CompileStats& compile_stats, std::size_t threads = 1);
+		// Matchers are read only after Load, any number of threads may process files at once.
+		// row_allocations counts the allocations evaluating rows made, which stops growing
+		// once each worker's buffers fit the rows.
+		std::optional<std::size_t> Process(const std::string& ss_file, GlobalList::Counters& counters,
+		                                   std::size_t& records_processed, std::size_t& row_allocations,
+		                                   std::size_t threads = 1) const;
+		// Shards, isolated patterns and DFA fallbacks of the RE2 sets of each field, the
+		// fallbacks count the values processed so far
+		RegexStats GetRegexStats() const;
 
 	private:
+		// Reads the sets is_in_domainset entries name, entries whose set couldn't be read
+		// are left in errors with the reason
+		void LoadDomainSets(const GlobalList& safelist, std::unordered_map<std::string, std::string>& errors);
+
+	private:
+		std::string domain_set_path;
+		// Shared by the string fields, declared ahead of them
+		DomainSets domain_sets;
 		GlobalAddressMatcher ip;
 		GlobalStringMatcher host;
 		GlobalStringMatcher helo;
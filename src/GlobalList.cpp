@@ -7,10 +7,9 @@
  * @license MIT
  */
 #include "GlobalList.h"
-#include "CsvParser.h"
+#include "MappedCsvParser.h"
 #include "Utils.h"
 #include <iostream>
-#include <cstring>
 #include <chrono>
 #include "re2/re2.h"
 #include <numeric>
@@ -18,17 +17,16 @@
 void Proofpoint::GlobalList::Load(const std::string& list_file, EntryErrors& entry_errors)
 {
 	std::size_t line_number = 0;
-	std::ifstream f(list_file);
-	csv::CsvParser parser(f);
-	for (auto& row : parser)
+	csv::MappedCsvParser parser(list_file);
+	for (const auto& row : parser)
 	{
 		line_number++;
 		size_t cols = row.size();
-		FieldType ft = (cols > 0) ? GetFieldType(row.at(0)) : FieldType::UNKNOWN;
-		MatchType mt = (cols > 1) ? GetMatchType(row.at(1)) : MatchType::UNKNOWN;
+		FieldType ft = (cols > 0) ? GetFieldType(row[0]) : FieldType::UNKNOWN;
+		MatchType mt = (cols > 1) ? GetMatchType(row[1]) : MatchType::UNKNOWN;
 
 		// Skip empty lines
-		if (cols == 1 && Utils::trim_copy(row.at(0)).empty())
+		if (cols == 1 && Utils::trim_copy(std::string(row[0])).empty())
 			continue;
 
 		if (ft == FieldType::UNKNOWN || mt == MatchType::UNKNOWN)
@@ -58,8 +56,8 @@ void Proofpoint::GlobalList::Load(const std::string& list_file, EntryErrors& ent
 		entries.back().line_number = line_number;
 		entries.back().field_type = ft;
 		entries.back().match_type = mt;
-		if (cols > 2) entries.back().pattern = row.at(2);
-		if (cols > 3) entries.back().comment = row.at(3);
+		if (cols > 2) entries.back().pattern = row[2];
+		if (cols > 3) entries.back().comment = row[3];
 		entries.back().inbound = 0;
 		entries.back().outbound = 0;
 	}
@@ -94,48 +92,48 @@ void Proofpoint::GlobalList::Save(const std::string& list_file)
 	}
 }
 
-inline Proofpoint::GlobalList::FieldType Proofpoint::GlobalList::GetFieldType(const std::string& field)
+inline Proofpoint::GlobalList::FieldType Proofpoint::GlobalList::GetFieldType(std::string_view field)
 {
-	if (strcmp("$ip", field.c_str()) == 0)
+	if (field == "$ip")
 		return FieldType::IP;
-	if (strcmp("$host", field.c_str()) == 0)
+	if (field == "$host")
 		return FieldType::HOST;
-	if (strcmp("$helo", field.c_str()) == 0)
+	if (field == "$helo")
 		return FieldType::HELO;
-	if (strcmp("$rcpt", field.c_str()) == 0)
+	if (field == "$rcpt")
 		return FieldType::RCPT;
-	if (strcmp("$from", field.c_str()) == 0)
+	if (field == "$from")
 		return FieldType::FROM;
-	if (strcmp("$hfrom", field.c_str()) == 0)
+	if (field == "$hfrom")
 		return FieldType::HFROM;
 	return FieldType::UNKNOWN;
 }
 
-inline const std::string& Proofpoint::GlobalList::GetFieldTypeString(Proofpoint::GlobalList::FieldType field)
+const std::string& Proofpoint::GlobalList::GetFieldTypeString(Proofpoint::GlobalList::FieldType field)
 {
 	return FieldTypeStrings[static_cast<int>(field)];
 }
 
-inline Proofpoint::GlobalList::MatchType Proofpoint::GlobalList::GetMatchType(const std::string& field)
+inline Proofpoint::GlobalList::MatchType Proofpoint::GlobalList::GetMatchType(std::string_view field)
 {
-	// strcmp has consistently better times than string.compare or ==
-	if (strcmp("equal", field.c_str()) == 0)
+	// Fields are views into the mapped list, compare without building a std::string
+	if (field == "equal")
 		return MatchType::EQUAL;
-	else if (strcmp("not_equal", field.c_str()) == 0)
+	else if (field == "not_equal")
 		return MatchType::NOT_EQUAL;
-	else if (strcmp("match", field.c_str()) == 0)
+	else if (field == "match")
 		return MatchType::MATCH;
-	else if (strcmp("not_match", field.c_str()) == 0)
+	else if (field == "not_match")
 		return MatchType::NOT_MATCH;
-	else if (strcmp("regex", field.c_str()) == 0)
+	else if (field == "regex")
 		return MatchType::REGEX;
-	else if (strcmp("not_regex", field.c_str()) == 0)
+	else if (field == "not_regex")
 		return MatchType::NOT_REGEX;
-	else if (strcmp("ip_in_net", field.c_str()) == 0)
+	else if (field == "ip_in_net")
 		return MatchType::IP_IN_NET;
-	else if (strcmp("ip_not_in_net", field.c_str()) == 0)
+	else if (field == "ip_not_in_net")
 		return MatchType::IP_NOT_IN_NET;
-	else if (strcmp("is_in_domainset", field.c_str()) == 0)
+	else if (field == "is_in_domainset")
 		return MatchType::IS_IN_DOMAINSET;
 	else
 		return MatchType::UNKNOWN;
@@ -161,3 +159,41 @@ std::size_t Proofpoint::GlobalList::GetOutboundCount() const
 		return a + b.outbound;
 	});
 }
+
+void Proofpoint::GlobalList::Merge(const Counters& counters)
+{
+	for (std::size_t i = 0; i < entries.size() && i < counters.size(); i++)
+	{
+		entries[i].inbound += counters[i].inbound;
+		entries[i].outbound += counters[i].outbound;
+	}
+}
+
+void Proofpoint::GlobalList::Merge(Counters& total, const Counters& counters)
+{
+	for (std::size_t i = 0; i < total.size() && i < counters.size(); i++)
+	{
+		total[i].inbound += counters[i].inbound;
+		total[i].outbound += counters[i].outbound;
+	}
+}
+
+void Proofpoint::GlobalList::Count(bool inbound, bool inverted, std::span<const std::size_t> indexes,
+                                   Counters& counters)
+{
+	const uint32_t step = inverted ? static_cast<uint32_t>(-1) : 1;
+	for (auto i : indexes)
+	{
+		(inbound) ? counters[i].inbound += step : counters[i].outbound += step;
+	}
+}
+
+void Proofpoint::GlobalList::Finalize(const Counter& evaluated, const std::vector<std::size_t>& indexes,
+                                      Counters& counters)
+{
+	for (auto i : indexes)
+	{
+		counters[i].inbound += evaluated.inbound;
+		counters[i].outbound += evaluated.outbound;
+	}
+}
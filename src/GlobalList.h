@@ -9,7 +9,9 @@
 #ifndef SLANALYZER_SAFELIST_H
 #define SLANALYZER_SAFELIST_H
 #include <string>
+#include <string_view>
 #include <memory>
+#include <span>
 #include <vector>
 
 namespace Proofpoint
@@ -44,6 +46,9 @@ namespace Proofpoint
 			IS_IN_DOMAINSET
 		};
 
+		// Size of a table indexed by MatchType
+		static constexpr std::size_t MATCH_TYPE_COUNT = static_cast<std::size_t>(MatchType::IS_IN_DOMAINSET) + 1;
+
 		struct Entry
 		{
 			std::size_t line_number;
@@ -57,6 +62,15 @@ namespace Proofpoint
 
 		using Entries = std::vector<Entry>;
 
+		// Match counts kept apart from the entries so each worker can count on its own
+		struct Counter
+		{
+			uint32_t inbound;
+			uint32_t outbound;
+		};
+
+		using Counters = std::vector<Counter>;
+
 		struct EntryError
 		{
 			std::size_t line_number;
@@ -70,9 +84,9 @@ namespace Proofpoint
 		using const_iterator = Entries::const_iterator;
 
 	public:
-		static FieldType GetFieldType(const std::string& field);
+		static FieldType GetFieldType(std::string_view field);
 		static const std::string& GetFieldTypeString(FieldType field);
-		static MatchType GetMatchType(const std::string& field);
+		static MatchType GetMatchType(std::string_view field);
 		static const std::string& GetMatchTypeString(MatchType matchtype);
 
 	private:
@@ -91,6 +105,14 @@ namespace Proofpoint
 
 	public:
 		[[nodiscard]] inline std::size_t GetCount() const { return entries.size(); }
+		[[nodiscard]] Counters MakeCounters() const { return Counters(entries.size(), Counter{0, 0}); }
+		void Merge(const Counters& counters);
+		static void Merge(Counters& total, const Counters& counters);
+		// Counts a match of each entry, an inverted matcher's entries are taken off instead
+		// and the unsigned counters may wrap until Finalize adds the values evaluated
+		static void Count(bool inbound, bool inverted, std::span<const std::size_t> indexes, Counters& counters);
+		// Adds the values evaluated to the counters of an inverted matcher's entries
+		static void Finalize(const Counter& evaluated, const std::vector<std::size_t>& indexes, Counters& counters);
 		[[nodiscard]] std::size_t GetInboundCount() const;
 		[[nodiscard]] std::size_t GetOutboundCount() const;
 		iterator begin() { return entries.begin(); }
@@ -7,74 +7,171 @@
  * @license MIT
  */
 #include "GlobalStringMatcher.h"
-#include "Matcher.h"
-#include "InvertedMatcher.h"
 
-Proofpoint::GlobalStringMatcher::GlobalStringMatcher()
+Proofpoint::GlobalStringMatcher::GlobalStringMatcher(const DomainSets& domain_sets, std::int64_t regex_mem,
+                                                     bool addresses)
 	:
-	matchers({
-		{GlobalList::MatchType::EQUAL, std::make_shared<Matcher<std::size_t>>(true, false, RE2::ANCHOR_BOTH)},
-		{
-			GlobalList::MatchType::NOT_EQUAL,
-			std::make_shared<InvertedMatcher<std::size_t>>(true, false, RE2::ANCHOR_BOTH)
-		},
-		{GlobalList::MatchType::MATCH, std::make_shared<Matcher<std::size_t>>(true, false, RE2::UNANCHORED)},
-		{
-			GlobalList::MatchType::NOT_MATCH,
-			std::make_shared<InvertedMatcher<std::size_t>>(true, false, RE2::UNANCHORED)
-		},
-		{GlobalList::MatchType::REGEX, std::make_shared<Matcher<std::size_t>>(false, false, RE2::UNANCHORED)},
-		{
-			GlobalList::MatchType::NOT_REGEX,
-			std::make_shared<InvertedMatcher<std::size_t>>(false, false, RE2::UNANCHORED)
-		}
-	})
+	prefix(AffixMatcher<std::size_t>::Side::PREFIX),
+	not_prefix(AffixMatcher<std::size_t>::Side::PREFIX),
+	suffix(AffixMatcher<std::size_t>::Side::SUFFIX),
+	not_suffix(AffixMatcher<std::size_t>::Side::SUFFIX),
+	regex(addresses, regex_mem),
+	not_regex(addresses, regex_mem),
+	in_domainset(domain_sets),
+	matchers{},
+	active(0)
 {
+	matchers[static_cast<std::size_t>(GlobalList::MatchType::EQUAL)] = &equal;
+	matchers[static_cast<std::size_t>(GlobalList::MatchType::NOT_EQUAL)] = &not_equal;
+	matchers[static_cast<std::size_t>(GlobalList::MatchType::MATCH)] = &match;
+	matchers[static_cast<std::size_t>(GlobalList::MatchType::NOT_MATCH)] = &not_match;
+	matchers[static_cast<std::size_t>(GlobalList::MatchType::REGEX)] = &regex;
+	matchers[static_cast<std::size_t>(GlobalList::MatchType::NOT_REGEX)] = &not_regex;
+	matchers[static_cast<std::size_t>(GlobalList::MatchType::IS_IN_DOMAINSET)] = &in_domainset;
+	matchers[PREFIX] = &prefix;
+	matchers[NOT_PREFIX] = &not_prefix;
+	matchers[SUFFIX] = &suffix;
+	matchers[NOT_SUFFIX] = &not_suffix;
 }
 
-void Proofpoint::GlobalStringMatcher::Add(Proofpoint::GlobalList::MatchType type, const std::string& pattern,
-                                          const std::size_t& index, PatternErrors<std::size_t>& pattern_errors)
+template <typename Fn>
+void Proofpoint::GlobalStringMatcher::Visit(Fn&& fn) const
 {
-	if (type == GlobalList::MatchType::IS_IN_DOMAINSET || type == GlobalList::MatchType::UNKNOWN) return;
-	matchers[type]->Add(pattern, index, pattern_errors);
+	// Expanded per engine so Match and IsInverted bind statically, empty engines are skipped
+	// with a single test of the mask
+	auto visit = [this, &fn](std::size_t slot, const auto& engine)
+	{
+		if (active & (1u << slot))
+			fn(slot, engine);
+	};
+	visit(static_cast<std::size_t>(GlobalList::MatchType::EQUAL), equal);
+	visit(static_cast<std::size_t>(GlobalList::MatchType::NOT_EQUAL), not_equal);
+	visit(static_cast<std::size_t>(GlobalList::MatchType::MATCH), match);
+	visit(static_cast<std::size_t>(GlobalList::MatchType::NOT_MATCH), not_match);
+	visit(PREFIX, prefix);
+	visit(NOT_PREFIX, not_prefix);
+	visit(SUFFIX, suffix);
+	visit(NOT_SUFFIX, not_suffix);
+	visit(static_cast<std::size_t>(GlobalList::MatchType::REGEX), regex);
+	visit(static_cast<std::size_t>(GlobalList::MatchType::NOT_REGEX), not_regex);
+	visit(static_cast<std::size_t>(GlobalList::MatchType::IS_IN_DOMAINSET), in_domainset);
 }
 
-bool Proofpoint::GlobalStringMatcher::Match(bool inbound, const std::string& pattern, GlobalList::Entries& safe_list)
+void Proofpoint::GlobalStringMatcher::Add(Proofpoint::GlobalList::MatchType type, const std::string& pattern,
+                                          const std::size_t& index, PatternErrors<std::size_t>& pattern_errors)
 {
-	std::vector<std::size_t> match_indexes;
-	bool matched = false;
-	for (auto m : matchers)
+	std::size_t slot = static_cast<std::size_t>(type);
+	const std::string* added = &pattern;
+
+	// A regex which is a literal goes to the engine looking that literal up
+	RegexLiteral literal;
+	if (type == GlobalList::MatchType::REGEX || type == GlobalList::MatchType::NOT_REGEX)
 	{
-		if (m.second->GetPatternCount())
+		literal = RegexLiteral::Parse(pattern);
+		const bool inverted = type == GlobalList::MatchType::NOT_REGEX;
+		switch (literal.form)
+		{
+		case RegexLiteral::Form::EXACT:
+			slot = static_cast<std::size_t>(inverted ? GlobalList::MatchType::NOT_EQUAL : GlobalList::MatchType::EQUAL);
+			break;
+		case RegexLiteral::Form::SUBSTRING:
+			slot = static_cast<std::size_t>(inverted ? GlobalList::MatchType::NOT_MATCH : GlobalList::MatchType::MATCH);
+			break;
+		case RegexLiteral::Form::PREFIX: slot = inverted ? NOT_PREFIX : PREFIX;
+			break;
+		case RegexLiteral::Form::SUFFIX: slot = inverted ? NOT_SUFFIX : SUFFIX;
+			break;
+		case RegexLiteral::Form::NONE: break;
+		}
+		if (literal.form != RegexLiteral::Form::NONE)
 		{
-			matched |= m.second->Match(pattern, match_indexes);
-			for (auto i : match_indexes)
-			{
-				(inbound) ? safe_list[i].inbound++ : safe_list[i].outbound++;
-			}
+			added = &literal.literal;
+			demoted++;
 		}
 	}
+
+	IMatcher<std::size_t>* matcher = matchers[slot];
+	if (!matcher) return;
+	matcher->Add(*added, index, pattern_errors);
+	if (matcher->GetPatternCount())
+		active |= 1u << slot;
+}
+
+bool Proofpoint::GlobalStringMatcher::Match(bool inbound, std::string_view pattern, GlobalList::Counters& counters,
+                                            GlobalList::Counter& evaluated, MatchScratch<std::size_t>& scratch) const
+{
+	std::vector<std::size_t>& match_indexes = scratch.matches;
+	bool matched = false;
+	// Lowered once for every engine, which then don't fold case themselves
+	const bool ascii = Utils::ascii_lower_copy(pattern, scratch.lower);
+	const std::string_view lower = scratch.lower;
+	Visit([&](std::size_t, const auto& engine)
+	{
+		matched |= MatchValue(engine, pattern, ascii, lower, match_indexes, scratch);
+		GlobalList::Count(inbound, engine.IsInverted(), match_indexes, counters);
+	});
+	(inbound) ? evaluated.inbound++ : evaluated.outbound++;
 	return matched;
 }
 
 bool Proofpoint::GlobalStringMatcher::Match(bool inbound, const std::vector<std::basic_string_view<char>>& patterns,
-                                            GlobalList::Entries& safe_list)
+                                            GlobalList::Counters& counters, GlobalList::Counter& evaluated,
+                                            MatchScratch<std::size_t>& scratch) const
 {
-	std::vector<std::size_t> match_indexes;
+	std::vector<std::size_t>& match_indexes = scratch.matches;
 	bool matched = false;
-	for (auto m : matchers)
+	for (const auto& pattern : patterns)
 	{
-		if (m.second->GetPatternCount())
+		const bool ascii = Utils::ascii_lower_copy(pattern, scratch.lower);
+		const std::string_view lower = scratch.lower;
+		Visit([&](std::size_t, const auto& engine)
 		{
-			for (const auto& pattern : patterns)
-			{
-				matched |= m.second->Match(std::string(pattern), match_indexes);
-				for (auto i : match_indexes)
-				{
-					(inbound) ? safe_list[i].inbound++ : safe_list[i].outbound++;
-				}
-			}
-		}
+			matched |= MatchValue(engine, pattern, ascii, lower, match_indexes, scratch);
+			GlobalList::Count(inbound, engine.IsInverted(), match_indexes, counters);
+		});
 	}
+	(inbound) ? evaluated.inbound += static_cast<uint32_t>(patterns.size())
+	          : evaluated.outbound += static_cast<uint32_t>(patterns.size());
 	return matched;
 }
+
+void Proofpoint::GlobalStringMatcher::Finalize(const GlobalList::Counter& evaluated,
+                                               GlobalList::Counters& counters) const
+{
+	if (!evaluated.inbound && !evaluated.outbound)
+		return;
+
+	Visit([&](std::size_t, const auto& engine)
+	{
+		if (engine.IsInverted())
+			GlobalList::Finalize(evaluated, engine.GetPatternIndexes(), counters);
+	});
+}
+
+std::size_t Proofpoint::GlobalStringMatcher::GetPatternCount() const
+{
+	std::size_t count = 0;
+	Visit([&count](std::size_t, const auto& engine)
+	{
+		count += engine.GetPatternCount();
+	});
+	return count;
+}
+
+void Proofpoint::GlobalStringMatcher::GetRegexStat(RegexStat& stat) const
+{
+	Visit([&stat](std::size_t, const auto& engine)
+	{
+		engine.GetRegexStat(stat);
+	});
+}
+
+std::vector<Proofpoint::IMatcher<std::size_t>*> Proofpoint::GlobalStringMatcher::GetMatchers()
+{
+	std::vector<IMatcher<std::size_t>*> result;
+	Visit([this, &result](std::size_t slot, const auto&)
+	{
+		result.push_back(matchers[slot]);
+	});
+	return result;
+}
@@ -11,23 +11,81 @@
 
 #include "IMatcher.h"
 #include "GlobalList.h"
+#include "Matcher.h"
+#include "HashMatcher.h"
+#include "AhoCorasickMatcher.h"
+#include "AffixMatcher.h"
+#include "DomainPartitionMatcher.h"
+#include "DomainSetMatcher.h"
+#include "InvertedMatcher.h"
+#include "RegexLiteral.h"
 #include "Utils.h"
-#include <unordered_map>
+#include <array>
+#include <cstdint>
 
 namespace Proofpoint
 {
 	class GlobalStringMatcher
 	{
 	public:
-		GlobalStringMatcher();
+		// domain_sets resolves is_in_domainset entries, it must outlive the matcher. regex_mem
+		// is the memory each RE2 set of the regex entries may use, see Matcher. Fields holding
+		// addresses partition their regex entries by domain, see DomainPartitionMatcher.
+		explicit GlobalStringMatcher(const DomainSets& domain_sets,
+		                             std::int64_t regex_mem = Matcher<std::size_t>::DEFAULT_MAX_MEM,
+		                             bool addresses = false);
 		void Add(GlobalList::MatchType type, const std::string& pattern, const std::size_t& index,
 		         PatternErrors<std::size_t>& pattern_errors);
-		bool Match(bool inbound, const std::string& pattern, GlobalList::Entries& safe_list);
+		bool Match(bool inbound, std::string_view pattern, GlobalList::Counters& counters,
+		           GlobalList::Counter& evaluated, MatchScratch<std::size_t>& scratch) const;
 		bool Match(bool inbound, const std::vector<std::basic_string_view<char>>& patterns,
-		           GlobalList::Entries& safe_list);
+		           GlobalList::Counters& counters, GlobalList::Counter& evaluated,
+		           MatchScratch<std::size_t>& scratch) const;
+
+		// Counts the entries of inverted matchers for every value evaluated, see IMatcher::IsInverted
+		void Finalize(const GlobalList::Counter& evaluated, GlobalList::Counters& counters) const;
+
+		std::size_t GetPatternCount() const;
+		// Regex entries which turned out to be literals and went to a literal engine
+		std::size_t GetDemotedCount() const { return demoted; }
+
+		// Adds the RE2 sets of every engine to stat
+		void GetRegexStat(RegexStat& stat) const;
+
+		// Matchers holding patterns, each can be compiled on its own thread
+		std::vector<IMatcher<std::size_t>*> GetMatchers();
+
+	private:
+		// Calls fn(slot, engine) with the concrete type of every engine holding patterns
+		template <typename Fn>
+		void Visit(Fn&& fn) const;
+
+		// Slots past the match types, for regex and not_regex entries which are a literal
+		// the value starts or ends with. Entries which are an exact or substring literal
+		// join the equal and match engines instead.
+		static constexpr std::size_t PREFIX = GlobalList::MATCH_TYPE_COUNT;
+		static constexpr std::size_t NOT_PREFIX = PREFIX + 1;
+		static constexpr std::size_t SUFFIX = NOT_PREFIX + 1;
+		static constexpr std::size_t NOT_SUFFIX = SUFFIX + 1;
 
 	private:
-		std::unordered_map<GlobalList::MatchType, std::shared_ptr<IMatcher<std::size_t>>> matchers;
+		// Engine of each match type, the row path calls them by their concrete type
+		HashMatcher<std::size_t> equal;
+		InvertedMatcher<std::size_t, HashMatcher<std::size_t>> not_equal;
+		AhoCorasickMatcher<std::size_t> match;
+		InvertedMatcher<std::size_t, AhoCorasickMatcher<std::size_t>> not_match;
+		AffixMatcher<std::size_t> prefix;
+		InvertedMatcher<std::size_t, AffixMatcher<std::size_t>> not_prefix;
+		AffixMatcher<std::size_t> suffix;
+		InvertedMatcher<std::size_t, AffixMatcher<std::size_t>> not_suffix;
+		DomainPartitionMatcher<std::size_t> regex;
+		InvertedMatcher<std::size_t, DomainPartitionMatcher<std::size_t>> not_regex;
+		DomainSetMatcher<std::size_t> in_domainset;
+		// The engines above indexed by slot for loading, null where a match type has none
+		std::array<IMatcher<std::size_t>*, NOT_SUFFIX + 1> matchers;
+		// Bit of each slot holding patterns
+		std::uint32_t active;
+		std::size_t demoted = 0;
 	};
 }
 #endif //SLANALYZER_STRINGMATCHER_H
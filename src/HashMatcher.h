@@ -0,0 +1,258 @@
+/**
+ * This code was tested against C++20
+ *
+ * @author Ludvik Jerabek
+ * @package slanalyzer
+ * @version 1.0.0
+ * @license MIT
+ */
+#ifndef SLANALYZER_HASHMATCHER_H
+#define SLANALYZER_HASHMATCHER_H
+
+#include "IMatcher.h"
+#include "Matcher.h"
+#include "Utils.h"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Proofpoint
+{
+	// Case-insensitive literal equality behind an open addressing hash table, a drop in
+	// replacement for Matcher(true, false, RE2::ANCHOR_BOTH).
+	//
+	// ASCII patterns are hashed folded, the text is folded with Utils::ascii_fold_next
+	// which also covers the two non-ASCII characters RE2's Unicode folding maps onto ASCII
+	// letters. Patterns which aren't ASCII stay in an RE2 set so every case matches as before.
+	template <typename T>
+	class HashMatcher final : public IMatcher<T>
+	{
+	public:
+		HashMatcher() : other(true, false, RE2::ANCHOR_BOTH)
+		{
+		}
+
+	public:
+		void Add(const std::string& pattern, const T& index, PatternErrors<T>& pattern_errors) override;
+		void Compile(PatternErrors<T>& pattern_errors) override;
+		bool Match(std::string_view pattern, std::vector<T>& match_indexes, MatchScratch<T>& scratch) const override;
+		std::size_t GetPatternCount() const override;
+		std::vector<T> GetPatternIndexes() const override;
+
+		// See IMatcher::Match
+		bool MatchAscii(std::string_view text, std::string_view lower, std::vector<T>& match_indexes,
+		                MatchScratch<T>& scratch) const;
+
+		void GetRegexStat(RegexStat& stat) const override
+		{
+			other.GetRegexStat(stat);
+		}
+
+	private:
+		struct Slot
+		{
+			std::uint64_t hash;
+			std::uint32_t key;
+			std::uint32_t length;
+			std::uint32_t postings;
+			std::uint32_t count; // Zero marks an empty slot
+		};
+
+		// Folded FNV-1a hash of text, false when text can't equal an ASCII pattern
+		static bool Hash(std::string_view text, std::uint64_t& hash)
+		{
+			hash = 0xcbf29ce484222325ULL;
+			for (std::size_t i = 0; i < text.size();)
+			{
+				const int c = Utils::ascii_fold_next(text, i);
+				if (c < 0)
+				{
+					return false;
+				}
+				hash = (hash ^ static_cast<std::uint64_t>(c)) * 0x100000001b3ULL;
+			}
+			return true;
+		}
+
+		// Whether the folded text equals a folded key
+		static bool Equal(std::string_view text, std::string_view key)
+		{
+			std::size_t i = 0;
+			for (char k : key)
+			{
+				if (i == text.size() || Utils::ascii_fold_next(text, i) != k)
+				{
+					return false;
+				}
+			}
+			return i == text.size();
+		}
+
+		// Appends the entries of the key equal(key) finds among those hashing to hash
+		template <typename Equal>
+		void Lookup(std::uint64_t hash, Equal&& equal, std::vector<T>& match_indexes) const
+		{
+			// The table is built by Compile, there's nothing to probe before
+			if (table.empty())
+			{
+				return;
+			}
+
+			for (std::uint64_t position = hash & mask; table[position].count; position = (position + 1) & mask)
+			{
+				const Slot& slot = table[position];
+				if (slot.hash != hash || !equal(std::string_view(keys.data() + slot.key, slot.length)))
+				{
+					continue;
+				}
+
+				match_indexes.insert(match_indexes.end(), postings.begin() + slot.postings,
+				                     postings.begin() + slot.postings + slot.count);
+				break;
+			}
+		}
+
+		void Build();
+
+	private:
+		std::once_flag built;
+		// Folded ASCII patterns waiting for the table to be built
+		std::vector<std::pair<std::string, T>> pending;
+		std::size_t ascii_count = 0;
+		std::vector<Slot> table;
+		std::uint64_t mask = 0;
+		std::string keys;
+		std::vector<T> postings;
+		// Patterns which aren't ASCII
+		Matcher<T> other;
+	};
+
+	template <typename T>
+	void HashMatcher<T>::Add(const std::string& pattern, const T& index, PatternErrors<T>& pattern_errors)
+	{
+		if (!Utils::is_ascii(pattern))
+		{
+			other.Add(pattern, index, pattern_errors);
+			return;
+		}
+
+		std::string folded(pattern);
+		std::transform(folded.begin(), folded.end(), folded.begin(), Utils::ascii_lower);
+		pending.emplace_back(std::move(folded), index);
+		ascii_count++;
+	}
+
+	template <typename T>
+	void HashMatcher<T>::Build()
+	{
+		// Equal keys are grouped so each one gets a single slot with a run of postings
+		std::stable_sort(pending.begin(), pending.end(), [](const auto& a, const auto& b)
+		{
+			return a.first < b.first;
+		});
+
+		table.assign(std::bit_ceil(std::max<std::size_t>(pending.size() * 2, 16)), Slot{0, 0, 0, 0, 0});
+		mask = table.size() - 1;
+		postings.reserve(pending.size());
+
+		for (std::size_t i = 0; i < pending.size();)
+		{
+			const std::string& key = pending[i].first;
+			Slot slot{0, static_cast<std::uint32_t>(keys.size()), static_cast<std::uint32_t>(key.size()),
+			          static_cast<std::uint32_t>(postings.size()), 0};
+			Hash(key, slot.hash);
+			keys += key;
+
+			for (; i < pending.size() && pending[i].first == key; i++)
+			{
+				postings.push_back(pending[i].second);
+				slot.count++;
+			}
+
+			std::uint64_t position = slot.hash & mask;
+			while (table[position].count)
+			{
+				position = (position + 1) & mask;
+			}
+			table[position] = slot;
+		}
+
+		pending.clear();
+		pending.shrink_to_fit();
+	}
+
+	template <typename T>
+	void HashMatcher<T>::Compile(PatternErrors<T>& pattern_errors)
+	{
+		std::call_once(built, [this] { Build(); });
+		if (other.GetPatternCount())
+		{
+			other.Compile(pattern_errors);
+		}
+	}
+
+	template <typename T>
+	bool HashMatcher<T>::Match(std::string_view pattern, std::vector<T>& match_indexes,
+                               MatchScratch<T>& scratch) const
+	{
+		match_indexes.clear();
+
+		std::uint64_t hash;
+		if (Hash(pattern, hash))
+		{
+			Lookup(hash, [pattern](std::string_view key) { return Equal(pattern, key); }, match_indexes);
+		}
+
+		if (other.GetPatternCount())
+		{
+			other.Match(pattern, scratch.indexes, scratch);
+			match_indexes.insert(match_indexes.end(), scratch.indexes.begin(), scratch.indexes.end());
+		}
+
+		return !match_indexes.empty();
+	}
+
+	template <typename T>
+	bool HashMatcher<T>::MatchAscii(std::string_view text, std::string_view lower, std::vector<T>& match_indexes,
+	                                MatchScratch<T>& scratch) const
+	{
+		match_indexes.clear();
+
+		// Already folded, hashed and compared as it is
+		std::uint64_t hash = 0xcbf29ce484222325ULL;
+		for (const char c : lower)
+		{
+			hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ULL;
+		}
+		Lookup(hash, [lower](std::string_view key) { return key == lower; }, match_indexes);
+
+		if (other.GetPatternCount())
+		{
+			other.MatchAscii(text, lower, scratch.indexes, scratch);
+			match_indexes.insert(match_indexes.end(), scratch.indexes.begin(), scratch.indexes.end());
+		}
+
+		return !match_indexes.empty();
+	}
+
+	template <typename T>
+	std::vector<T> HashMatcher<T>::GetPatternIndexes() const
+	{
+		// Every ASCII pattern left one posting behind
+		std::vector<T> indexes(postings);
+		std::vector<T> other_indexes = other.GetPatternIndexes();
+		indexes.insert(indexes.end(), other_indexes.begin(), other_indexes.end());
+		return indexes;
+	}
+
+	template <typename T>
+	std::size_t HashMatcher<T>::GetPatternCount() const
+	{
+		return ascii_count + other.GetPatternCount();
+	}
+}
+#endif //SLANALYZER_HASHMATCHER_H
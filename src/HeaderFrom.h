@@ -0,0 +1,123 @@
+/**
+ * This code was tested against C++20
+ *
+ * @author Ludvik Jerabek
+ * @package slanalyzer
+ * @version 1.0.0
+ * @license MIT
+ */
+#ifndef SLANALYZER_HEADERFROM_H
+#define SLANALYZER_HEADERFROM_H
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace Proofpoint
+{
+	// Address only part of a Header_From value, "Name <user@example.com>" becomes
+	// "user@example.com". A value without an address is returned as is.
+	//
+	// Gives the same result as the first group of the unanchored RE2 match of
+	//   <?\s*([a-zA-Z0-9.!#$%&’*+\/=?^_`{|}~-]+@[a-zA-Z0-9-]+(?:\.[a-zA-Z0-9-]+)*)\s*>?\s*(?:;|$)
+	// without running a regex. Neither the local part nor the domain can hold an @, so the
+	// leftmost match belongs to the first @ whose local part is not empty and whose domain is
+	// followed by the end of the value or a ';', optionally behind spaces and a '>'. The
+	// local part is then the whole run of local characters in front of that @.
+	class HeaderFrom
+	{
+	public:
+		[[nodiscard]] std::string_view Extract(std::string_view value) const
+		{
+			const char* const begin = value.data();
+			const char* const end = begin + value.size();
+
+			for (const char* at = begin; (at = static_cast<const char*>(std::memchr(at, '@', end - at))); at++)
+			{
+				const char* local = LocalStart(begin, at);
+				if (local == at)
+					continue;
+
+				const char* domain_end = DomainEnd(at + 1, end);
+				if (domain_end == at + 1 || !EndsAddress(domain_end, end))
+					continue;
+
+				return {local, static_cast<std::size_t>(domain_end - local)};
+			}
+			return value;
+		}
+
+	private:
+		enum : uint8_t
+		{
+			SPACE = 1,
+			DOMAIN = 2,
+			LOCAL = 4
+		};
+
+		// Class bits of every byte, the checks below are a single load each
+		static constexpr std::array<uint8_t, 256> CLASSES = []
+		{
+			std::array<uint8_t, 256> classes{};
+			// Characters RE2 matches with \s
+			for (unsigned char c : std::string_view(" \t\n\f\r"))
+				classes[c] = SPACE;
+			for (unsigned char c : std::string_view("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-"))
+				classes[c] = DOMAIN | LOCAL;
+			for (unsigned char c : std::string_view(".!#$%&*+/=?^_`{|}~"))
+				classes[c] = LOCAL;
+			return classes;
+		}();
+
+		static bool Is(char c, uint8_t bits)
+		{
+			return CLASSES[static_cast<unsigned char>(c)] & bits;
+		}
+
+		// Start of the run of local part characters ending at at. ’ (U+2019) is the one
+		// multibyte character of the class, E2 80 99 in UTF-8, and E2 can only lead a sequence.
+		static const char* LocalStart(const char* begin, const char* at)
+		{
+			const char* p = at;
+			while (p > begin)
+			{
+				if (Is(p[-1], LOCAL))
+					p--;
+				else if (p - begin >= 3 && std::string_view(p - 3, 3) == "\xE2\x80\x99")
+					p -= 3;
+				else
+					break;
+			}
+			return p;
+		}
+
+		// End of the dot separated labels starting at p, p when there is no label
+		static const char* DomainEnd(const char* p, const char* end)
+		{
+			const char* last = p;
+			while (p < end && Is(*p, DOMAIN))
+			{
+				while (p < end && Is(*p, DOMAIN))
+					p++;
+				last = p;
+				if (p < end && *p == '.')
+					p++;
+			}
+			return last;
+		}
+
+		// Whether \s*>?\s*(?:;|$) matches from p
+		static bool EndsAddress(const char* p, const char* end)
+		{
+			while (p < end && Is(*p, SPACE))
+				p++;
+			if (p < end && *p == '>')
+				p++;
+			while (p < end && Is(*p, SPACE))
+				p++;
+			return p == end || *p == ';';
+		}
+	};
+}
+#endif //SLANALYZER_HEADERFROM_H
@@ -9,11 +9,31 @@
 #ifndef SLANALYZER_IMATCHER_H
 #define SLANALYZER_IMATCHER_H
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace Proofpoint
 {
+	// RE2 sets behind the matchers of one field, see Matcher
+	struct RegexStat
+	{
+		std::string name;
+		// Memory each shard took to compile
+		std::vector<std::int64_t> shard_memory;
+		// Memory of the Latin-1 copies of those shards ASCII values run on, see Matcher
+		std::vector<std::int64_t> latin1_shard_memory;
+		// Patterns matched as regexes of their own since they'd blow up a set's DFA
+		std::size_t isolated = 0;
+		// Values a shard's DFA ran out of memory on and matched pattern by pattern
+		std::size_t fallbacks = 0;
+		// Domains the regexes were split by, see DomainPartitionMatcher
+		std::size_t partitions = 0;
+	};
+
+	using RegexStats = std::vector<RegexStat>;
+
 	template <typename T>
 	class IMatcher
 	{
@@ -27,14 +47,91 @@ namespace Proofpoint
 
 		using PatternErrors = std::vector<PatternError>;
 
+		// Buffers owned by the calling thread and reused across Match calls, a compiled
+		// matcher keeps no per call state of its own
+		struct Scratch
+		{
+			// Entry indexes a caller collects matches into
+			std::vector<T> matches;
+			// Where the matches of each value start when several are matched at once
+			std::vector<std::uint32_t> offsets;
+			// Used by the matchers themselves
+			std::vector<int> ids;
+			std::vector<std::uint32_t> states;
+			std::vector<T> indexes;
+			std::vector<int> candidates;
+			// Folded copy of a value
+			std::string text;
+			// Lowercase copy of the value being matched, owned by the caller of MatchAscii
+			std::string lower;
+			// Partitions a value falls in and the matches of one, see DomainPartitionMatcher
+			std::vector<T> partitions;
+			std::vector<T> partial;
+		};
+
 	public:
+		virtual ~IMatcher() = default;
+
 		virtual void Add(const std::string& pattern, const T& index, PatternErrors& pattern_errors) = 0;
-		virtual bool Match(const std::string& pattern, std::vector<T>& match_indexes) = 0;
-		virtual std::size_t GetPatternCount() = 0;
+		// Compiles the patterns ahead of the first Match, a set which can't be compiled is
+		// reported here once and never matches. The matcher is read only afterwards.
+		virtual void Compile(PatternErrors& pattern_errors) = 0;
+		// Safe to call from several threads at once after Compile, each with its own scratch.
+		//
+		// Engines which can skip case folding also offer a non-virtual
+		// MatchAscii(text, lower, match_indexes, scratch) for an ASCII text whose lowercase
+		// copy lower the caller made once for every engine, with the same result as Match.
+		virtual bool Match(std::string_view pattern, std::vector<T>& match_indexes, Scratch& scratch) const = 0;
+		virtual std::size_t GetPatternCount() const = 0;
+
+		// Inverted matchers count an entry for every value its pattern did not match. Match
+		// reports the entries whose pattern did match instead, the caller counts every value
+		// evaluated once and takes those entries off, so the cost scales with the matches.
+		virtual bool IsInverted() const { return false; }
+
+		// Entry of every pattern, an entry with several patterns is listed once per pattern.
+		// Patterns which could not be compiled are left out. Used to count inverted matchers.
+		virtual std::vector<T> GetPatternIndexes() const = 0;
+
+		// Adds the RE2 sets the matcher compiled to stat, matchers without any leave it be
+		virtual void GetRegexStat(RegexStat&) const {}
 	};
 
 	template <typename T>
 	using PatternErrors = typename IMatcher<T>::PatternErrors;
+
+	template <typename T>
+	using MatchScratch = typename IMatcher<T>::Scratch;
+
+	// Matches value through engine.MatchAscii when value is ASCII and the engine has one,
+	// lower being its lowercase copy, and through engine.Match otherwise
+	template <typename T, typename Engine>
+	bool MatchValue(const Engine& engine, std::string_view value, bool ascii, std::string_view lower,
+	                std::vector<T>& match_indexes, MatchScratch<T>& scratch)
+	{
+		if constexpr (requires { engine.MatchAscii(value, lower, match_indexes, scratch); })
+		{
+			if (ascii)
+				return engine.MatchAscii(value, lower, match_indexes, scratch);
+		}
+		return engine.Match(value, match_indexes, scratch);
+	}
+
+	// Time and memory compiling the patterns of one field took
+	struct CompileStat
+	{
+		std::string name;
+		std::size_t patterns;
+		double seconds;
+		std::int64_t memory;
+		// Regex entries matched by a literal engine, see RegexLiteral
+		std::size_t demoted = 0;
+		// memory is the size of the structure built rather than allocations counted, it's
+		// known whether or not those are tracked
+		bool sized = false;
+	};
+
+	using CompileStats = std::vector<CompileStat>;
 }
 
 #endif //SLANALYZER_IMATCHER_H
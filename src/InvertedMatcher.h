@@ -10,110 +10,92 @@
 #define SLANALYZER_INVERTEDMATCHER_H
 
 #include "IMatcher.h"
-#include "re2/re2.h"
-#include "re2/set.h"
-#include <memory>
-#include <unordered_map>
-#include <unordered_set>
+#include "IpAddress.h"
+#include "Matcher.h"
+#include <span>
+#include <utility>
+#include <vector>
 
 namespace Proofpoint
 {
-	template <typename T>
-	class InvertedMatcher : public IMatcher<T>
+	// Counts an entry for every value the patterns of the wrapped matcher don't match.
+	// Match reports the entries which did match, see IMatcher::IsInverted, so any engine
+	// doubles as its inverted form: not_equal uses the hash table, not_match the
+	// Aho-Corasick automaton, not_regex the prefiltered regexes and ip_not_in_net the
+	// subnet trie.
+	template <typename T, typename Engine = Matcher<T>>
+	class InvertedMatcher final : public IMatcher<T>
 	{
 	public:
-		explicit InvertedMatcher(bool literal = false, bool case_sensitive = false,
-		                         RE2::Anchor anchor = RE2::ANCHOR_BOTH);
-		~InvertedMatcher() { delete match; }
+		template <typename... Args>
+		explicit InvertedMatcher(Args&&... args) : engine(std::forward<Args>(args)...)
+		{
+		}
 
 	public:
-		void Add(const std::string& pattern, const T& index, PatternErrors<T>& pattern_errors) override;
-		bool Match(const std::string& pattern, std::vector<T>& match_indexes) override;
-		std::size_t GetPatternCount() override;
-
-	private:
-		bool compiled;
-		bool compile_failed;
-		RE2::Options opt;
-		RE2::Set* match;
-		std::unordered_map<int, T> map_to_global_list;
-	};
-
-
-	template <typename T>
-	Proofpoint::InvertedMatcher<
-		T>::InvertedMatcher(bool literal, bool case_sensitive, RE2::Anchor anchor) : compiled(false),
-		compile_failed(false)
-	{
-		opt.set_literal(literal);
-		opt.set_case_sensitive(case_sensitive);
-		opt.set_log_errors(false);
-		// Set max memory to 16mb per pattern
-		opt.set_max_mem(16777216);
-		match = new RE2::Set(opt, anchor);
-	}
-
-	template <typename T>
-	void Proofpoint::InvertedMatcher<T>::Add(const std::string& pattern, const T& index,
-	                                         PatternErrors<T>& pattern_errors)
-	{
-		std::string error;
-		int i = match->Add(pattern, &error);
-		if (i == -1)
+		void Add(const std::string& pattern, const T& index, PatternErrors<T>& pattern_errors) override
 		{
-			pattern_errors.push_back({index, pattern, error});
-			return;
+			engine.Add(pattern, index, pattern_errors);
 		}
-		map_to_global_list.insert({i, index});
-	}
 
-	template <typename T>
-	bool Proofpoint::InvertedMatcher<T>::Match(const std::string& pattern, std::vector<T>& match_indexes)
-	{
-		match_indexes.clear();
-		match_indexes.reserve(map_to_global_list.size());
-		if (!compiled)
+		void Compile(PatternErrors<T>& pattern_errors) override
 		{
-			compile_failed = match->Compile();
-			compiled = true;
+			engine.Compile(pattern_errors);
 		}
 
-		if (!compile_failed)
+		bool Match(std::string_view pattern, std::vector<T>& match_indexes, MatchScratch<T>& scratch) const override
 		{
-			std::cerr << "Failed to compile" << std::endl;
-			return false;
+			return !engine.Match(pattern, match_indexes, scratch);
 		}
 
-		std::vector<int> m;
-
-		bool matched = !match->Match(pattern, &m);
+		// For engines which match a value lowered ahead of time, see IMatcher::Match
+		bool MatchAscii(std::string_view text, std::string_view lower, std::vector<T>& match_indexes,
+		                MatchScratch<T>& scratch) const
+			requires requires(const Engine& e, std::vector<T>& m, MatchScratch<T>& s) { e.MatchAscii(text, lower, m, s); }
+		{
+			return !engine.MatchAscii(text, lower, match_indexes, scratch);
+		}
 
-		if (m.empty())
+		// For engines matching an address the caller already parsed
+		bool Match(const IpAddress& address, std::vector<T>& match_indexes, MatchScratch<T>& scratch) const
+			requires requires(const Engine& e, std::vector<T>& m, MatchScratch<T>& s) { e.Match(address, m, s); }
 		{
-			for (const auto& item : map_to_global_list)
+			return !engine.Match(address, match_indexes, scratch);
+		}
+
+		// Entries whose pattern did match each address, same as Match
+		void MatchBatch(std::span<const uint32_t> addresses, std::vector<uint32_t>& offsets,
+		                std::vector<T>& match_indexes, MatchScratch<T>& scratch) const
+			requires requires(const Engine& e, std::vector<uint32_t>& o, std::vector<T>& m, MatchScratch<T>& s)
 			{
-				match_indexes.emplace_back(item.second);
+				e.MatchBatch(addresses, o, m, s);
 			}
-			return matched;
+		{
+			engine.MatchBatch(addresses, offsets, match_indexes, scratch);
 		}
 
-		std::unordered_set<int> matched_set(m.begin(), m.end());
+		std::size_t GetPatternCount() const override
+		{
+			return engine.GetPatternCount();
+		}
 
-		for (const auto& item : map_to_global_list)
+		bool IsInverted() const override
 		{
-			if (matched_set.find(item.first) == matched_set.end())
-			{
-				match_indexes.emplace_back(item.second);
-			}
+			return true;
+		}
+
+		std::vector<T> GetPatternIndexes() const override
+		{
+			return engine.GetPatternIndexes();
 		}
 
-		return matched;
-	}
+		void GetRegexStat(RegexStat& stat) const override
+		{
+			engine.GetRegexStat(stat);
+		}
 
-	template <typename T>
-	std::size_t Proofpoint::InvertedMatcher<T>::GetPatternCount()
-	{
-		return map_to_global_list.size();
-	}
+	private:
+		Engine engine;
+	};
 }
 #endif //SLANALYZER_INVERTEDMATCHER_H
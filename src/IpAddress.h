@@ -0,0 +1,51 @@
+/**
+ * This code was tested against C++20
+ *
+ * @author Ludvik Jerabek
+ * @package slanalyzer
+ * @version 1.0.0
+ * @license MIT
+ */
+#ifndef SLANALYZER_IPADDRESS_H
+#define SLANALYZER_IPADDRESS_H
+
+#include "Subnet.h"
+#include "Subnet6.h"
+#include <cstdint>
+#include <string_view>
+
+namespace Proofpoint
+{
+	// Sender_IP_Address parsed once per row, the $ip engines which work on addresses share it
+	// rather than each parsing the text again
+	struct IpAddress
+	{
+		enum class Family
+		{
+			NONE,
+			V4,
+			V6
+		};
+
+		Family family = Family::NONE;
+		// Host order
+		uint32_t v4 = 0;
+		Address6 v6{0, 0};
+
+		static IpAddress Parse(std::string_view text)
+		{
+			IpAddress address;
+			if (text.find(':') != std::string_view::npos)
+			{
+				if (Subnet6::ParseAddress(text, address.v6))
+					address.family = Family::V6;
+			}
+			else if (Subnet::ParseAddress(text, address.v4))
+			{
+				address.family = Family::V4;
+			}
+			return address;
+		}
+	};
+}
+#endif //SLANALYZER_IPADDRESS_H
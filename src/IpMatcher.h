@@ -0,0 +1,167 @@
+/**
+ * This code was tested against C++20
+ *
+ * @author Ludvik Jerabek
+ * @package slanalyzer
+ * @version 1.0.0
+ * @license MIT
+ */
+#ifndef SLANALYZER_IPMATCHER_H
+#define SLANALYZER_IPMATCHER_H
+
+#include "IMatcher.h"
+#include "IpAddress.h"
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace Proofpoint
+{
+	// Equality of IPv4 addresses compared as host order integers, a drop in replacement for
+	// HashMatcher on equal entries whose pattern is an IPv4 address. Addresses live in an
+	// open addressing table sized to at most half full, so a row is usually a single probe
+	// however many addresses a list holds.
+	//
+	// Subnet::ParseAddress only accepts the canonical dotted quad so two addresses are equal
+	// as integers exactly when they are equal as text, a value which doesn't parse can't
+	// equal any of the patterns.
+	template <typename T>
+	class IpMatcher final : public IMatcher<T>
+	{
+	public:
+		void Add(const std::string& pattern, const T& index, PatternErrors<T>& pattern_errors) override;
+		void Compile(PatternErrors<T>& pattern_errors) override;
+		bool Match(std::string_view pattern, std::vector<T>& match_indexes, MatchScratch<T>& scratch) const override;
+		// Same as above for an address the caller already parsed
+		bool Match(const IpAddress& address, std::vector<T>& match_indexes, MatchScratch<T>& scratch) const;
+		std::size_t GetPatternCount() const override;
+		std::vector<T> GetPatternIndexes() const override;
+
+	private:
+		struct Slot
+		{
+			uint32_t address;
+			uint32_t postings;
+			uint32_t count; // Zero marks an empty slot
+		};
+
+		// Fibonacci hashing, the multiply spreads neighbouring addresses across the table
+		static uint64_t Hash(uint32_t address)
+		{
+			return (static_cast<uint64_t>(address) * 0x9E3779B97F4A7C15ULL) >> 32;
+		}
+
+		void Build();
+
+	private:
+		std::once_flag built;
+		// Address of each pattern and its entry until the table is built
+		std::vector<std::pair<uint32_t, T>> pending;
+		std::size_t pattern_count = 0;
+		std::vector<Slot> table;
+		uint64_t mask = 0;
+		// Entries of each address, every pattern left one posting behind
+		std::vector<T> postings;
+	};
+
+	template <typename T>
+	void IpMatcher<T>::Add(const std::string& pattern, const T& index, PatternErrors<T>& pattern_errors)
+	{
+		in_addr_t address = 0;
+		if (!Subnet::ParseAddress(pattern, address))
+		{
+			pattern_errors.push_back({index, pattern, "Invalid IPv4 address [" + pattern + "]"});
+			return;
+		}
+		pending.emplace_back(address, index);
+		pattern_count++;
+	}
+
+	template <typename T>
+	void IpMatcher<T>::Build()
+	{
+		// Equal addresses are grouped so each one gets a single slot with a run of postings
+		std::stable_sort(pending.begin(), pending.end(), [](const auto& a, const auto& b)
+		{
+			return a.first < b.first;
+		});
+
+		table.assign(std::bit_ceil(std::max<std::size_t>(pending.size() * 2, 16)), Slot{0, 0, 0});
+		mask = table.size() - 1;
+		postings.reserve(pending.size());
+
+		for (std::size_t i = 0; i < pending.size();)
+		{
+			Slot slot{pending[i].first, static_cast<uint32_t>(postings.size()), 0};
+			for (; i < pending.size() && pending[i].first == slot.address; i++)
+			{
+				postings.push_back(pending[i].second);
+				slot.count++;
+			}
+
+			uint64_t position = Hash(slot.address) & mask;
+			while (table[position].count)
+			{
+				position = (position + 1) & mask;
+			}
+			table[position] = slot;
+		}
+
+		pending.clear();
+		pending.shrink_to_fit();
+	}
+
+	template <typename T>
+	void IpMatcher<T>::Compile(PatternErrors<T>&)
+	{
+		std::call_once(built, [this] { Build(); });
+	}
+
+	template <typename T>
+	bool IpMatcher<T>::Match(std::string_view pattern, std::vector<T>& match_indexes,
+	                         MatchScratch<T>& scratch) const
+	{
+		return Match(IpAddress::Parse(pattern), match_indexes, scratch);
+	}
+
+	template <typename T>
+	bool IpMatcher<T>::Match(const IpAddress& address, std::vector<T>& match_indexes,
+	                         MatchScratch<T>&) const
+	{
+		match_indexes.clear();
+
+		// The table is built by Compile, there's nothing to probe before
+		if (address.family != IpAddress::Family::V4 || table.empty())
+		{
+			return false;
+		}
+
+		for (uint64_t position = Hash(address.v4) & mask; table[position].count; position = (position + 1) & mask)
+		{
+			const Slot& slot = table[position];
+			if (slot.address == address.v4)
+			{
+				match_indexes.insert(match_indexes.end(), postings.begin() + slot.postings,
+				                     postings.begin() + slot.postings + slot.count);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	template <typename T>
+	std::size_t IpMatcher<T>::GetPatternCount() const
+	{
+		return pattern_count;
+	}
+
+	template <typename T>
+	std::vector<T> IpMatcher<T>::GetPatternIndexes() const
+	{
+		return postings;
+	}
+}
+#endif //SLANALYZER_IPMATCHER_H
@@ -0,0 +1,693 @@
+/**
+ * This code was tested against C++20
+ *
+ * @author Ludvik Jerabek
+ * @package slanalyzer
+ * @version 1.0.0
+ * @license MIT
+ */
+#ifndef SLANALYZER_MAPPEDCSVPARSER_H
+#define SLANALYZER_MAPPEDCSVPARSER_H
+
+#include "CsvParser.h"
+#include "StructuralIndex.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <span>
+#include <string_view>
+
+namespace csv
+{
+	// Read only memory mapping of an entire file
+	class MappedFile
+	{
+	public:
+		explicit MappedFile(const std::string& file)
+		{
+			int fd = ::open(file.c_str(), O_RDONLY);
+			if (fd == -1)
+			{
+				throw std::runtime_error("Unable to open file [" + file + "]");
+			}
+
+			struct stat st{};
+			if (::fstat(fd, &st) == -1)
+			{
+				::close(fd);
+				throw std::runtime_error("Unable to stat file [" + file + "]");
+			}
+
+			m_size = static_cast<std::size_t>(st.st_size);
+
+			// A zero length mapping is invalid, an empty file is simply an empty view
+			if (m_size > 0)
+			{
+				void* data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (data == MAP_FAILED)
+				{
+					::close(fd);
+					throw std::runtime_error("Unable to map file [" + file + "]");
+				}
+				::madvise(data, m_size, MADV_SEQUENTIAL);
+				m_data = static_cast<const char*>(data);
+			}
+
+			// The mapping stays valid after the descriptor is closed
+			::close(fd);
+		}
+
+		~MappedFile()
+		{
+			if (m_data)
+			{
+				::munmap(const_cast<char*>(m_data), m_size);
+			}
+		}
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		[[nodiscard]] const char* data() const { return m_data; }
+		[[nodiscard]] std::size_t size() const { return m_size; }
+		[[nodiscard]] std::string_view view() const { return {m_data, m_size}; }
+
+	private:
+		const char* m_data = nullptr;
+		std::size_t m_size = 0;
+	};
+
+	// Fixed column positions of the fields a reader asked for, compiled once from the
+	// header so rows can be read by slot instead of looking each name up per row
+	class Projection
+	{
+	public:
+		static constexpr std::size_t NONE = std::numeric_limits<std::size_t>::max();
+
+		Projection() = default;
+
+		// Slot i is the first column named fields[i], fields missing from the header stay empty
+		Projection(const HeaderList& fields, const HeaderMap& header_map)
+		{
+			m_columns.reserve(fields.size());
+			for (const auto& field : fields)
+			{
+				auto found = header_map.find(field);
+				m_columns.push_back(found == header_map.end() ? NONE : found->second);
+			}
+
+			for (std::size_t slot = 0; slot < m_columns.size(); ++slot)
+			{
+				const std::size_t column = m_columns[slot];
+				if (column == NONE)
+				{
+					continue;
+				}
+				if (column >= m_slots.size())
+				{
+					m_slots.resize(column + 1, NONE);
+				}
+				if (m_slots[column] == NONE)
+				{
+					m_slots[column] = slot;
+				}
+				else
+				{
+					m_aliases.emplace_back(slot, m_slots[column]);
+				}
+			}
+		}
+
+		// Number of fields handed back per row
+		[[nodiscard]] std::size_t size() const { return m_columns.size(); }
+
+		// Columns a row needs to carry every projected field
+		[[nodiscard]] std::size_t width() const { return m_slots.size(); }
+
+		// Column of a slot
+		[[nodiscard]] std::size_t column(std::size_t slot) const { return m_columns[slot]; }
+
+		// Slots sharing a column with an earlier slot, paired with the slot they copy
+		[[nodiscard]] const std::vector<std::pair<std::size_t, std::size_t>>& aliases() const { return m_aliases; }
+
+		// Slot a column is read into, NONE when the column is skipped
+		[[nodiscard]] std::size_t slot(std::size_t column) const
+		{
+			return column < m_slots.size() ? m_slots[column] : NONE;
+		}
+
+	private:
+		std::vector<std::size_t> m_columns;
+		std::vector<std::size_t> m_slots;
+		std::vector<std::pair<std::size_t, std::size_t>> m_aliases;
+	};
+
+	// Zero-copy CSV reader over a memory mapped file. Rows are returned as a span of
+	// std::string_view pointing directly into the mapping, only quoted fields which
+	// contain escaped quotes (or trailing data after the closing quote) are unescaped
+	// into a per-field buffer owned by the iterator. Field semantics are identical to
+	// CsvParser which splits on commas, uses quotes to escape, and handles rows ending
+	// in either '\r', '\n', or '\r\n'.
+	class MappedCsvParser
+	{
+	public:
+		using Row = std::span<const std::string_view>;
+
+	private:
+		// Why next_field stopped
+		enum class Stop
+		{
+			DELIMITER,
+			ROW_END,
+			CSV_END
+		};
+
+		// Unescape state machine, only used for fields that can't be returned as a view
+		enum class State
+		{
+			IN_FIELD,
+			IN_QUOTED_FIELD,
+			IN_ESCAPED_QUOTE
+		};
+
+		// Configurable attributes
+		char m_quote = '"';
+		char m_delimiter = ',';
+
+		// Mapping is optional, the parser can also run over a caller owned buffer
+		std::unique_ptr<MappedFile> m_file;
+		const char* m_begin = nullptr;
+		const char* m_cursor = nullptr;
+		const char* m_end = nullptr;
+
+#ifndef SLANALYZER_NO_SIMD
+		// Separator positions for the bytes ahead of the cursor
+		StructuralIndex m_index{m_quote, m_delimiter};
+#endif
+
+	public:
+		// Maps the file and parses it in its entirety
+		explicit MappedCsvParser(const std::string& file)
+			: m_file(std::make_unique<MappedFile>(file))
+		{
+			m_begin = m_file->data();
+			m_cursor = m_begin;
+			m_end = m_begin + m_file->size();
+		}
+
+		// Parses a caller owned buffer which must outlive the parser
+		explicit MappedCsvParser(std::string_view input)
+			: m_begin(input.data()), m_cursor(input.data()), m_end(input.data() + input.size())
+		{
+		}
+
+		// Change the quote character
+		MappedCsvParser& quote(char c) noexcept
+		{
+			m_quote = c;
+#ifndef SLANALYZER_NO_SIMD
+			m_index = StructuralIndex(m_quote, m_delimiter);
+#endif
+			return *this;
+		}
+
+		// Change the delimiter character
+		MappedCsvParser& delimiter(char c) noexcept
+		{
+			m_delimiter = c;
+#ifndef SLANALYZER_NO_SIMD
+			m_index = StructuralIndex(m_quote, m_delimiter);
+#endif
+			return *this;
+		}
+
+		// The parser is empty when there are no more bytes left to read
+		[[nodiscard]] bool empty() const
+		{
+			return m_cursor == m_end;
+		}
+
+		// Offset of the next unread byte
+		[[nodiscard]] std::size_t position() const
+		{
+			return static_cast<std::size_t>(m_cursor - m_begin);
+		}
+
+		// Total bytes available to the parser
+		[[nodiscard]] std::size_t size() const
+		{
+			return static_cast<std::size_t>(m_end - m_begin);
+		}
+
+		// Moves the cursor to offset, which must be the start of a row for the
+		// following reads to line up with what a reader from the beginning sees
+		void seek(std::size_t offset)
+		{
+			m_cursor = m_begin + std::min(offset, size());
+#ifndef SLANALYZER_NO_SIMD
+			m_index.Clear();
+#endif
+		}
+
+		// Reads the next row into the views, fields which required unescaping are backed by
+		// the matching entry in unescaped, a deque so growing it never moves the buffers
+		// earlier fields point into. Returns false when there are no more rows.
+		bool next_row(std::vector<std::string_view>& row, std::deque<std::string>& unescaped)
+		{
+			row.clear();
+
+			if (empty())
+			{
+				return false;
+			}
+
+			for (;;)
+			{
+				if (unescaped.size() <= row.size())
+				{
+					unescaped.resize(row.size() + 1);
+				}
+
+				std::string_view field;
+				switch (next_field(field, &unescaped[row.size()]))
+				{
+				case Stop::DELIMITER: row.push_back(field);
+					break;
+				case Stop::ROW_END: row.push_back(field);
+					return true;
+				case Stop::CSV_END:
+					// Matches CsvParser, an empty trailing field at the end of input is dropped
+					if (!field.empty())
+					{
+						row.push_back(field);
+					}
+					return !row.empty();
+				}
+			}
+		}
+
+		// Reads only the projected fields of the next row, row[i] is the field in slot i.
+		// Other columns are stepped over without being unescaped. Rows too short to carry
+		// every projected field are consumed but come back empty. Returns false when there
+		// are no more rows.
+		bool next_row(const Projection& projection, std::vector<std::string_view>& row,
+		              std::deque<std::string>& unescaped)
+		{
+			row.assign(projection.size(), std::string_view{});
+
+			if (empty())
+			{
+				row.clear();
+				return false;
+			}
+
+			if (unescaped.size() < projection.size())
+			{
+				unescaped.resize(projection.size());
+			}
+
+			std::size_t columns = 0;
+			for (;;)
+			{
+				const std::size_t slot = projection.slot(columns);
+
+				std::string_view field;
+				const Stop stop = (slot == Projection::NONE)
+					                  ? next_field(field, nullptr)
+					                  : next_field(field, &unescaped[slot]);
+
+				// Matches CsvParser, an empty trailing field at the end of input is dropped
+				if (stop != Stop::CSV_END || !field.empty())
+				{
+					if (slot != Projection::NONE)
+					{
+						row[slot] = field;
+					}
+					++columns;
+				}
+
+				if (stop != Stop::DELIMITER)
+				{
+					break;
+				}
+			}
+
+			if (columns < projection.width())
+			{
+				row.clear();
+			}
+			else
+			{
+				for (const auto& [slot, source] : projection.aliases())
+				{
+					row[slot] = row[source];
+				}
+			}
+			return columns > 0;
+		}
+
+	private:
+		[[nodiscard]] static bool is_terminator(char c)
+		{
+			return c == '\r' || c == '\n';
+		}
+
+		// Consumes a terminator, treating '\r\n' as a single terminator
+		[[nodiscard]] const char* skip_terminator(const char* p) const
+		{
+			if (*p == '\r' && p + 1 != m_end && p[1] == '\n')
+			{
+				return p + 2;
+			}
+			return p + 1;
+		}
+
+#ifndef SLANALYZER_NO_SIMD
+		// Separator ending the field at the cursor, the index is rebuilt from the cursor
+		// once it runs dry. Returns nullptr when the index can't vouch for the field, it is
+		// longer than a chunk, runs to the end of input or has irregular quoting.
+		const char* next_separator()
+		{
+			if (const char* stop = m_index.Next(m_cursor))
+			{
+				return stop;
+			}
+			m_index.Build(m_cursor, m_end);
+			return m_index.Next(m_cursor);
+		}
+#endif
+
+		// First delimiter or terminator at or after p, m_end if there is none
+		[[nodiscard]] const char* find_structural(const char* p) const
+		{
+			while (p != m_end && *p != m_delimiter && !is_terminator(*p))
+			{
+				++p;
+			}
+			return p;
+		}
+
+		// Reads the field at the cursor. Fields which need unescaping are written to
+		// unescaped, a skipped field passes nullptr and only the field's emptiness is kept.
+		Stop next_field(std::string_view& field, std::string* unescaped)
+		{
+			const char* start = m_cursor;
+
+			if (start == m_end)
+			{
+				field = {};
+				return Stop::CSV_END;
+			}
+
+#ifndef SLANALYZER_NO_SIMD
+			if (const char* stop = next_separator())
+			{
+				if (*start != m_quote)
+				{
+					field = {start, static_cast<std::size_t>(stop - start)};
+					return finish_field(stop);
+				}
+
+				// The index guarantees the closing quote sits right before the separator
+				const char* open = start + 1;
+				const char* close = stop - 1;
+				if (!std::memchr(open, m_quote, close - open))
+				{
+					field = {open, static_cast<std::size_t>(close - open)};
+					return finish_field(stop);
+				}
+				return unescape_field(field, unescaped);
+			}
+#endif
+
+			if (*start != m_quote)
+			{
+				const char* stop = find_structural(start);
+				field = {start, static_cast<std::size_t>(stop - start)};
+				return finish_field(stop);
+			}
+
+			// Quoted field, the common case is a closing quote directly followed by a
+			// delimiter, a terminator or the end of input which needs no unescaping
+			const char* open = start + 1;
+			const auto* close = static_cast<const char*>(std::memchr(open, m_quote, m_end - open));
+
+			if (!close)
+			{
+				field = {open, static_cast<std::size_t>(m_end - open)};
+				m_cursor = m_end;
+				return Stop::CSV_END;
+			}
+
+			const char* next = close + 1;
+			if (next == m_end || *next == m_delimiter || is_terminator(*next))
+			{
+				field = {open, static_cast<std::size_t>(close - open)};
+				return finish_field(next);
+			}
+
+			return unescape_field(field, unescaped);
+		}
+
+		// Moves the cursor past the structural character that ended the field
+		Stop finish_field(const char* stop)
+		{
+			if (stop == m_end)
+			{
+				m_cursor = m_end;
+				return Stop::CSV_END;
+			}
+
+			if (*stop == m_delimiter)
+			{
+				m_cursor = stop + 1;
+				return Stop::DELIMITER;
+			}
+
+			m_cursor = skip_terminator(stop);
+			return Stop::ROW_END;
+		}
+
+		// Slow path for quoted fields containing escaped quotes, this is the same state
+		// machine CsvParser runs for every byte, started just past the opening quote.
+		Stop unescape_field(std::string_view& field, std::string* unescaped)
+		{
+			State state = State::IN_QUOTED_FIELD;
+			const char* p = m_cursor + 1;
+			std::size_t length = 0;
+
+			auto append = [&](char c)
+			{
+				if (unescaped)
+				{
+					*unescaped += c;
+				}
+				++length;
+			};
+
+			// A skipped field is never read, only its length tells an empty field apart
+			auto result = [&]() -> std::string_view
+			{
+				return unescaped ? std::string_view(*unescaped) : std::string_view(m_cursor, length);
+			};
+
+			if (unescaped)
+			{
+				unescaped->clear();
+			}
+
+			for (; p != m_end; ++p)
+			{
+				const char c = *p;
+				switch (state)
+				{
+				case State::IN_QUOTED_FIELD:
+					if (c == m_quote)
+					{
+						state = State::IN_ESCAPED_QUOTE;
+					}
+					else
+					{
+						append(c);
+					}
+					break;
+
+				case State::IN_ESCAPED_QUOTE:
+					if (c == m_quote)
+					{
+						state = State::IN_QUOTED_FIELD;
+						append(c);
+						break;
+					}
+					if (c == m_delimiter || is_terminator(c))
+					{
+						field = result();
+						return finish_field(p);
+					}
+					state = State::IN_FIELD;
+					append(c);
+					break;
+
+				case State::IN_FIELD:
+					if (c == m_delimiter || is_terminator(c))
+					{
+						field = result();
+						return finish_field(p);
+					}
+					append(c);
+					break;
+				}
+			}
+
+			field = result();
+			m_cursor = m_end;
+			return Stop::CSV_END;
+		}
+
+	public:
+		// Iterator implementation for the mapped parser, which reads from
+		// the CSV row by row in the form of a span of string views
+		class iterator
+		{
+		public:
+			using difference_type = std::ptrdiff_t;
+			using value_type = Row;
+			using pointer = const Row*;
+			using reference = const Row&;
+			using iterator_category = std::input_iterator_tag;
+
+			explicit iterator(MappedCsvParser* p, bool end = false)
+				: m_parser(p), m_end(end)
+			{
+				if (!end)
+				{
+					m_fields.reserve(64);
+					next();
+				}
+			}
+
+			iterator& operator++()
+			{
+				next();
+				return *this;
+			}
+
+			bool operator==(const iterator& other) const
+			{
+				return m_end == other.m_end;
+			}
+
+			bool operator!=(const iterator& other) const
+			{
+				return !(*this == other);
+			}
+
+			reference operator*() const
+			{
+				return m_row;
+			}
+
+			pointer operator->() const
+			{
+				return &m_row;
+			}
+
+		private:
+			MappedCsvParser* m_parser;
+			bool m_end;
+			std::vector<std::string_view> m_fields{};
+			std::deque<std::string> m_unescaped{};
+			Row m_row{};
+
+			void next()
+			{
+				m_end = !m_parser->next_row(m_fields, m_unescaped);
+				m_row = Row(m_fields.data(), m_fields.size());
+			}
+		};
+
+		iterator begin() { return iterator(this); };
+		iterator end() { return iterator(this, true); };
+
+	public:
+		std::optional<HeaderIndex> FindHeader(
+			const HeaderList& required_fields,
+			HeaderMap& header_map,
+			std::size_t search_limit = 0)
+		{
+			HeaderIndex lines_read = 0;
+
+			for (const auto& row : *this)
+			{
+				if (search_limit > 0 && lines_read >= search_limit)
+				{
+					break;
+				}
+
+				++lines_read;
+
+				if (row.size() < required_fields.size())
+				{
+					continue;
+				}
+
+				std::size_t max_req = 0;
+
+				const bool found_all = std::ranges::all_of(
+					required_fields,
+					[&max_req, &row](const std::string& field)
+					{
+						auto found = std::find(row.begin(), row.end(), field);
+
+						if (found == row.end())
+						{
+							return false;
+						}
+
+						auto index = static_cast<std::size_t>(
+							std::distance(row.begin(), found)
+						);
+
+						max_req = std::max(max_req, index);
+						return true;
+					});
+
+				if (found_all)
+				{
+					header_map.clear();
+
+					for (std::size_t index = 0; index < row.size(); ++index)
+					{
+						header_map.emplace(std::string(row[index]), index);
+					}
+
+					return max_req;
+				}
+			}
+
+			return std::nullopt;
+		}
+
+		// Same header search, compiling the required fields into a projection for
+		// next_row. Slots follow the order of required_fields.
+		std::optional<HeaderIndex> FindHeader(
+			const HeaderList& required_fields,
+			Projection& projection,
+			std::size_t search_limit = 0)
+		{
+			HeaderMap header_map;
+			auto header_index = FindHeader(required_fields, header_map, search_limit);
+			if (header_index)
+			{
+				projection = Projection(required_fields, header_map);
+			}
+			return header_index;
+		}
+	};
+}
+#endif //SLANALYZER_MAPPEDCSVPARSER_H
@@ -10,89 +10,448 @@
 #define SLANALYZER_MATCHER_H
 
 #include "IMatcher.h"
+#include "Memory.h"
+#include "Utils.h"
 #include "re2/re2.h"
 #include "re2/set.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdlib>
 #include <memory>
-#include <unordered_map>
-#include <iostream>
+#include <mutex>
+#include <string_view>
+#include <vector>
 
 namespace Proofpoint
 {
+	// Patterns matched through RE2 sets, each set (shard) kept within max_mem.
+	//
+	// RE2 caps a set's program at a quarter of max_mem and caches DFA states in the rest. A
+	// set whose program doesn't fit fails to compile, and one whose DFA outgrows its cache
+	// keeps throwing states away, so the patterns are split into as many shards as it takes
+	// for each to compile at half the program cap. A pattern with a counted repetition of a
+	// character class, such as .{20}, multiplies the DFA states of every pattern it shares a
+	// set with; those are detected as they're added and run as regexes of their own, which
+	// fall back to the NFA when their DFA runs out. A shard whose DFA runs out of memory on a
+	// value is counted and matched one pattern at a time instead of missing its matches.
+	//
+	// When every pattern is ASCII they're also compiled into Latin-1 sets, which MatchAscii
+	// runs over ASCII values without decoding UTF-8. On ASCII text the two encodings match
+	// alike, a non-ASCII pattern could still match it by folding K to the Kelvin sign, so a
+	// single one keeps only the UTF-8 sets.
 	template <typename T>
-	class Matcher : public IMatcher<T>
+	class Matcher final : public IMatcher<T>
 	{
 	public:
-		explicit Matcher(bool literal = false, bool case_sensitive = false, RE2::Anchor anchor = RE2::ANCHOR_BOTH);
-		~Matcher() { delete match; }
+		// Memory RE2 may use for each set, the default of the --regex-mem option
+		static constexpr std::int64_t DEFAULT_MAX_MEM = 16777216;
+
+		explicit Matcher(bool literal = false, bool case_sensitive = false, RE2::Anchor anchor = RE2::ANCHOR_BOTH,
+		                 std::int64_t max_mem = DEFAULT_MAX_MEM);
 
 	public:
 		void Add(const std::string& pattern, const T& index, PatternErrors<T>& pattern_errors) override;
-		bool Match(const std::string& pattern, std::vector<T>& match_indexes) override;
-		std::size_t GetPatternCount() override;
+		void Compile(PatternErrors<T>& pattern_errors) override;
+		bool Match(std::string_view pattern, std::vector<T>& match_indexes, MatchScratch<T>& scratch) const override;
+		std::size_t GetPatternCount() const override;
+		std::vector<T> GetPatternIndexes() const override;
+		void GetRegexStat(RegexStat& stat) const override;
+
+		// See IMatcher::Match
+		bool MatchAscii(std::string_view text, std::string_view lower, std::vector<T>& match_indexes,
+		                MatchScratch<T>& scratch) const;
+
+		// Whether a counted repetition of a character class, a wildcard or a class escape
+		// reaches EXPLOSIVE_REPEAT outside a pattern anchored at its start
+		static bool IsExplosive(std::string_view pattern);
+
+	private:
+		Matcher(const RE2::Options& options, RE2::Anchor anchor) : opt(options), anchor(anchor)
+		{
+			match = std::make_unique<RE2::Set>(opt, anchor);
+		}
+
+		// Counted repetitions from this many characters on go into their own regex
+		static constexpr int EXPLOSIVE_REPEAT = 8;
+		// RE2 caps a set's program at max_mem / INSTRUCTION_MEM instructions
+		static constexpr std::int64_t INSTRUCTION_MEM = 32;
+
+		struct Shard
+		{
+			std::unique_ptr<RE2::Set> set;
+			// Pattern of each set id
+			std::vector<std::size_t> patterns;
+			std::int64_t memory = 0;
+			// Regexes of the patterns, built the first time the DFA runs out of memory
+			mutable std::once_flag fallback_built;
+			mutable std::vector<std::unique_ptr<RE2>> fallback;
+		};
+
+		void Build(PatternErrors<T>& pattern_errors);
+		// Compiles patterns into one shard, splitting them in halves until each half compiles
+		void AddShard(std::vector<std::size_t> ids, PatternErrors<T>& pattern_errors);
+		void Fallback(const Shard& shard, std::string_view pattern, std::vector<T>& match_indexes) const;
 
 	private:
-		bool compiled;
-		bool compile_failed;
+		std::once_flag compiled;
 		RE2::Options opt;
-		RE2::Set* match;
-		std::unordered_map<int, T> map_to_list_entry;
+		RE2::Anchor anchor;
+		// Every pattern is added to a first set as it is added, which validates it and is
+		// used as is when the whole list compiles within the budget
+		std::unique_ptr<RE2::Set> match;
+		// Memory the patterns added to match took so far
+		std::int64_t match_memory = 0;
+		std::vector<std::string> patterns;
+		// Entry index of each pattern
+		std::vector<T> map_to_list_entry;
+		std::vector<std::unique_ptr<Shard>> shards;
+		// Explosive patterns as their own regexes and their patterns
+		std::vector<std::unique_ptr<RE2>> isolated;
+		std::vector<std::size_t> isolated_patterns;
+		// Entries of the patterns which compiled
+		std::vector<T> compiled_indexes;
+		mutable std::atomic<std::size_t> fallbacks = 0;
+		// The Latin-1 sets for ASCII values, null when some pattern isn't ASCII
+		std::unique_ptr<Matcher<T>> ascii;
 	};
 
 
 	template <typename T>
-	Proofpoint::Matcher<
-		T>::Matcher(bool literal, bool case_sensitive, RE2::Anchor anchor) : compiled(false), compile_failed(false)
+	Proofpoint::Matcher<T>::Matcher(bool literal, bool case_sensitive, RE2::Anchor anchor, std::int64_t max_mem)
+		: anchor(anchor)
 	{
 		opt.set_literal(literal);
 		opt.set_case_sensitive(case_sensitive);
 		opt.set_log_errors(false);
-		// Set max memory to 16mb per pattern
-		opt.set_max_mem(16777216);
-		match = new RE2::Set(opt, anchor);
+		opt.set_max_mem(max_mem);
+		match = std::make_unique<RE2::Set>(opt, anchor);
+
+		RE2::Options latin1 = opt;
+		latin1.set_encoding(RE2::Options::EncodingLatin1);
+		ascii.reset(new Matcher(latin1, anchor));
+	}
+
+	template <typename T>
+	bool Proofpoint::Matcher<T>::IsExplosive(std::string_view pattern)
+	{
+		// The leftmost start is the only start, the DFA follows one position at a time
+		if (pattern.starts_with('^') && pattern.find('|') == std::string_view::npos)
+		{
+			return false;
+		}
+
+		// Whether the atom ending in front of the current position matches many characters
+		bool broad = false;
+		for (std::size_t i = 0; i < pattern.size(); i++)
+		{
+			const char c = pattern[i];
+			if (c == '\\' && i + 1 < pattern.size())
+			{
+				const char e = pattern[++i];
+				broad = std::string_view("dDwWsSpP").find(e) != std::string_view::npos;
+			}
+			else if (c == '[')
+			{
+				// A ] right after [ or [^ is a member, not the end
+				std::size_t j = i + 1;
+				if (j < pattern.size() && pattern[j] == '^')
+					j++;
+				if (j < pattern.size() && pattern[j] == ']')
+					j++;
+				for (; j < pattern.size() && pattern[j] != ']'; j++)
+				{
+					if (pattern[j] == '\\')
+						j++;
+				}
+				i = j;
+				broad = true;
+			}
+			else if (c == '.')
+			{
+				broad = true;
+			}
+			else if (c == '{' && broad)
+			{
+				// {n}, {n,} or {n,m}, the larger bound counts
+				const char* p = pattern.data() + i + 1;
+				char* end = nullptr;
+				long count = std::strtol(p, &end, 10);
+				if (end == p)
+				{
+					broad = false;
+					continue;
+				}
+				if (*end == ',' && std::isdigit(static_cast<unsigned char>(end[1])))
+				{
+					count = std::max(count, std::strtol(end + 1, &end, 10));
+				}
+				if (count >= EXPLOSIVE_REPEAT)
+				{
+					return true;
+				}
+				broad = false;
+			}
+			else
+			{
+				broad = false;
+			}
+		}
+		return false;
 	}
 
 	template <typename T>
 	void Proofpoint::Matcher<T>::Add(const std::string& pattern, const T& index, PatternErrors<T>& pattern_errors)
 	{
 		std::string error;
-		int i = match->Add(pattern, &error);
-		if (i == -1)
+		if (!opt.literal() && anchor == RE2::UNANCHORED && IsExplosive(pattern))
+		{
+			auto regex = std::make_unique<RE2>(pattern, opt);
+			if (!regex->ok())
+			{
+				pattern_errors.push_back({index, pattern, regex->error()});
+				return;
+			}
+			isolated.push_back(std::move(regex));
+			isolated_patterns.push_back(patterns.size());
+		}
+		else
+		{
+			auto memory = Memory::thread_allocated();
+			const int id = match->Add(pattern, &error);
+			match_memory += Memory::thread_allocated() - memory;
+			if (id == -1)
+			{
+				pattern_errors.push_back({index, pattern, error});
+				return;
+			}
+		}
+		patterns.push_back(pattern);
+		map_to_list_entry.push_back(index);
+
+		if (ascii && !Utils::is_ascii(pattern))
+			ascii.reset();
+		if (ascii)
 		{
-			pattern_errors.push_back({index, pattern, error});
+			PatternErrors<T> latin1_errors;
+			ascii->Add(pattern, index, latin1_errors);
+			if (!latin1_errors.empty())
+				ascii.reset();
+		}
+	}
+
+	template <typename T>
+	void Proofpoint::Matcher<T>::AddShard(std::vector<std::size_t> ids, PatternErrors<T>& pattern_errors)
+	{
+		auto memory = Memory::thread_allocated();
+		auto shard = std::make_unique<Shard>();
+		shard->set = std::make_unique<RE2::Set>(opt, anchor);
+		for (std::size_t id : ids)
+		{
+			shard->set->Add(patterns[id], nullptr);
+		}
+
+		if (!shard->set->Compile())
+		{
+			if (ids.size() == 1)
+			{
+				pattern_errors.push_back({map_to_list_entry[ids.front()], patterns[ids.front()],
+				                          "Pattern failed to compile within the regex memory limit"});
+				return;
+			}
+			const auto half = ids.begin() + static_cast<std::ptrdiff_t>(ids.size() / 2);
+			AddShard(std::vector<std::size_t>(ids.begin(), half), pattern_errors);
+			AddShard(std::vector<std::size_t>(half, ids.end()), pattern_errors);
 			return;
 		}
-		map_to_list_entry.insert({i, index});
+		shard->memory = Memory::thread_allocated() - memory;
+		shard->patterns = std::move(ids);
+		shards.push_back(std::move(shard));
 	}
 
 	template <typename T>
-	bool Proofpoint::Matcher<T>::Match(const std::string& pattern, std::vector<T>& match_indexes)
+	void Proofpoint::Matcher<T>::Build(PatternErrors<T>& pattern_errors)
 	{
-		match_indexes.clear();
-		if (!compiled)
+		std::vector<std::size_t> ids;
+		for (std::size_t id = 0, next = 0; id < patterns.size(); id++)
 		{
-			compile_failed = match->Compile();
-			compiled = true;
+			if (next < isolated_patterns.size() && isolated_patterns[next] == id)
+				next++;
+			else
+				ids.push_back(id);
 		}
 
-		if (!compile_failed)
+		if (!ids.empty())
 		{
-			std::cerr << "Failed to compile" << std::endl;
-			return false;
+			// Most lists fit one set, the one which validated them
+			auto memory = Memory::thread_allocated() - match_memory;
+			if (match->Compile())
+			{
+				auto shard = std::make_unique<Shard>();
+				shard->set = std::move(match);
+				shard->memory = Memory::thread_allocated() - memory;
+				shard->patterns = std::move(ids);
+				shards.push_back(std::move(shard));
+			}
+			else
+			{
+				// Packed by program size to half the cap, a shard which still doesn't
+				// compile is split further
+				const std::int64_t capacity = opt.max_mem() / INSTRUCTION_MEM / 2;
+				std::vector<std::size_t> shard_ids;
+				std::int64_t instructions = 0;
+				for (std::size_t id : ids)
+				{
+					const std::int64_t size = RE2(patterns[id], opt).ProgramSize();
+					if (!shard_ids.empty() && instructions + size > capacity)
+					{
+						AddShard(std::move(shard_ids), pattern_errors);
+						shard_ids.clear();
+						instructions = 0;
+					}
+					shard_ids.push_back(id);
+					instructions += size;
+				}
+				if (!shard_ids.empty())
+				{
+					AddShard(std::move(shard_ids), pattern_errors);
+				}
+			}
 		}
+		match.reset();
 
-		std::vector<int> m;
-		bool matched = match->Match(pattern, &m);
-		for (auto index : m)
+		for (const auto& shard : shards)
+		{
+			for (std::size_t id : shard->patterns)
+				compiled_indexes.push_back(map_to_list_entry[id]);
+		}
+		for (std::size_t id : isolated_patterns)
 		{
-			match_indexes.emplace_back(map_to_list_entry[index]);
+			compiled_indexes.push_back(map_to_list_entry[id]);
 		}
-		return matched;
+
+		// Only kept when the Latin-1 sets compiled the same patterns the UTF-8 ones did
+		if (ascii)
+		{
+			PatternErrors<T> latin1_errors;
+			ascii->Compile(latin1_errors);
+			std::vector<T> latin1_indexes = ascii->GetPatternIndexes();
+			std::vector<T> indexes = compiled_indexes;
+			std::sort(latin1_indexes.begin(), latin1_indexes.end());
+			std::sort(indexes.begin(), indexes.end());
+			if (!latin1_errors.empty() || latin1_indexes != indexes)
+				ascii.reset();
+		}
+	}
+
+	template <typename T>
+	void Proofpoint::Matcher<T>::Compile(PatternErrors<T>& pattern_errors)
+	{
+		std::call_once(compiled, [this, &pattern_errors] { Build(pattern_errors); });
 	}
 
 	template <typename T>
-	std::size_t Proofpoint::Matcher<T>::GetPatternCount()
+	void Proofpoint::Matcher<T>::Fallback(const Shard& shard, std::string_view pattern,
+	                                      std::vector<T>& match_indexes) const
 	{
-		return map_to_list_entry.size();
+		fallbacks++;
+		std::call_once(shard.fallback_built, [this, &shard]
+		{
+			for (std::size_t id : shard.patterns)
+				shard.fallback.push_back(std::make_unique<RE2>(patterns[id], opt));
+		});
+
+		for (std::size_t i = 0; i < shard.patterns.size(); i++)
+		{
+			if (shard.fallback[i]->Match(pattern, 0, pattern.size(), anchor, nullptr, 0))
+			{
+				match_indexes.emplace_back(map_to_list_entry[shard.patterns[i]]);
+			}
+		}
+	}
+
+	template <typename T>
+	bool Proofpoint::Matcher<T>::Match(std::string_view pattern, std::vector<T>& match_indexes,
+                                       MatchScratch<T>& scratch) const
+	{
+		match_indexes.clear();
+
+		std::vector<int>& m = scratch.ids;
+		for (const auto& shard : shards)
+		{
+			// Asking for the ids makes RE2 allocate, most values match nothing so find out first
+			RE2::Set::ErrorInfo error;
+			if (!shard->set->Match(pattern, nullptr, &error))
+			{
+				if (error.kind == RE2::Set::kOutOfMemory)
+				{
+					Fallback(*shard, pattern, match_indexes);
+				}
+				continue;
+			}
+
+			if (!shard->set->Match(pattern, &m, &error))
+			{
+				if (error.kind == RE2::Set::kOutOfMemory)
+				{
+					Fallback(*shard, pattern, match_indexes);
+				}
+				continue;
+			}
+			for (auto id : m)
+			{
+				match_indexes.emplace_back(map_to_list_entry[shard->patterns[id]]);
+			}
+		}
+
+		for (std::size_t i = 0; i < isolated.size(); i++)
+		{
+			if (isolated[i]->Match(pattern, 0, pattern.size(), anchor, nullptr, 0))
+			{
+				match_indexes.emplace_back(map_to_list_entry[isolated_patterns[i]]);
+			}
+		}
+		return !match_indexes.empty();
+	}
+
+	template <typename T>
+	bool Proofpoint::Matcher<T>::MatchAscii(std::string_view text, std::string_view,
+	                                        std::vector<T>& match_indexes, MatchScratch<T>& scratch) const
+	{
+		return ascii ? ascii->Match(text, match_indexes, scratch) : Match(text, match_indexes, scratch);
+	}
+
+	template <typename T>
+	std::vector<T> Proofpoint::Matcher<T>::GetPatternIndexes() const
+	{
+		return compiled_indexes;
+	}
+
+	template <typename T>
+	std::size_t Proofpoint::Matcher<T>::GetPatternCount() const
+	{
+		// Build releases the first set, from then on patterns no shard could take don't count
+		return match ? map_to_list_entry.size() : compiled_indexes.size();
+	}
+
+	template <typename T>
+	void Proofpoint::Matcher<T>::GetRegexStat(RegexStat& stat) const
+	{
+		for (const auto& shard : shards)
+		{
+			stat.shard_memory.push_back(shard->memory);
+		}
+		stat.isolated += isolated.size();
+		stat.fallbacks += fallbacks;
+		if (ascii)
+		{
+			// The Latin-1 sets are copies of the sets above, not sets of their own
+			for (const auto& shard : ascii->shards)
+			{
+				stat.latin1_shard_memory.push_back(shard->memory);
+			}
+			stat.fallbacks += ascii->fallbacks;
+		}
 	}
 }
 #endif //SLANALYZER_MATCHER_H
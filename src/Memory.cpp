@@ -0,0 +1,195 @@
+/**
+ * This code was tested against C++20
+ *
+ * @author Ludvik Jerabek
+ * @package slanalyzer
+ * @version 1.0.0
+ * @license MIT
+ */
+#include "Memory.h"
+
+#ifdef SLANALYZER_TRACK_MEMORY
+
+#include <cstdlib>
+#include <malloc.h>
+#include <new>
+
+// Replaces the global operator new / delete so allocations can be accounted per thread,
+// RE2 allocates through them as well. Every allocation of the process pays for the
+// accounting, which is why it's only built with SLANALYZER_TRACK_MEMORY.
+static thread_local std::int64_t allocated = 0;
+static thread_local std::uint64_t allocations = 0;
+
+static void* allocate(std::size_t size, std::size_t alignment) noexcept
+{
+    void* p = nullptr;
+    if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+        p = std::malloc(size ? size : 1);
+    else if (posix_memalign(&p, alignment, size ? size : 1))
+        p = nullptr;
+
+    if (p)
+    {
+        allocated += static_cast<std::int64_t>(malloc_usable_size(p));
+        allocations++;
+    }
+    return p;
+}
+
+// As the library operator new does, the new_handler gets to free memory before giving up
+static void* allocate_or_throw(std::size_t size, std::size_t alignment)
+{
+    for (;;)
+    {
+        if (void* p = allocate(size, alignment))
+            return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+static void* allocate_or_null(std::size_t size, std::size_t alignment) noexcept
+{
+    try
+    {
+        return allocate_or_throw(size, alignment);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+static void release(void* p) noexcept
+{
+    if (!p)
+        return;
+    allocated -= static_cast<std::int64_t>(malloc_usable_size(p));
+    std::free(p);
+}
+
+std::int64_t Proofpoint::Memory::thread_allocated()
+{
+    return allocated;
+}
+
+std::uint64_t Proofpoint::Memory::thread_allocations()
+{
+    return allocations;
+}
+
+void* operator new(std::size_t size)
+{
+    return allocate_or_throw(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new[](std::size_t size)
+{
+    return allocate_or_throw(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate_or_null(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate_or_null(size, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return allocate_or_throw(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return allocate_or_throw(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return allocate_or_null(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return allocate_or_null(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* p) noexcept
+{
+    release(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    release(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    release(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    release(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+    release(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+    release(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+    release(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept
+{
+    release(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept
+{
+    release(p);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept
+{
+    release(p);
+}
+
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    release(p);
+}
+
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    release(p);
+}
+
+#else
+
+std::int64_t Proofpoint::Memory::thread_allocated()
+{
+    return 0;
+}
+
+std::uint64_t Proofpoint::Memory::thread_allocations()
+{
+    return 0;
+}
+
+#endif
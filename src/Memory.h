@@ -0,0 +1,33 @@
+/**
+ * This code was tested against C++20
+ *
+ * @author Ludvik Jerabek
+ * @package slanalyzer
+ * @version 1.0.0
+ * @license MIT
+ */
+#ifndef SLANALYZER_MEMORY_H
+#define SLANALYZER_MEMORY_H
+
+#include <cstdint>
+
+namespace Proofpoint::Memory
+{
+    // Whether the global operator new counts allocations, see the SLANALYZER_TRACK_MEMORY
+    // option. Without it the counters below stay at zero and operator new is the library's.
+#ifdef SLANALYZER_TRACK_MEMORY
+    inline constexpr bool tracked = true;
+#else
+    inline constexpr bool tracked = false;
+#endif
+
+    // Bytes the calling thread allocated through operator new less the bytes it released,
+    // the difference across a call is the memory that call kept. Memory released by
+    // another thread than the one which allocated it is only seen by the releasing thread.
+    std::int64_t thread_allocated();
+
+    // Number of operator new calls the calling thread made
+    std::uint64_t thread_allocations();
+}
+
+#endif //SLANALYZER_MEMORY_H
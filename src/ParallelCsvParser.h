@@ -0,0 +1,207 @@
+/**
+ * This code was tested against C++20
+ *
+ * @author Ludvik Jerabek
+ * @package slanalyzer
+ * @version 1.0.0
+ * @license MIT
+ */
+#ifndef SLANALYZER_PARALLELCSVPARSER_H
+#define SLANALYZER_PARALLELCSVPARSER_H
+
+#include "MappedCsvParser.h"
+#include <algorithm>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace csv
+{
+	// Splits a mapped CSV into byte ranges which are parsed on separate threads.
+	//
+	// Range boundaries are speculative: each thread counts the quotes in its slice of the
+	// input, the running parity tells whether a slice starts inside a quoted field, and
+	// the boundary is moved to the first row terminator outside quotes. That agrees with
+	// the CsvParser state machine as long as quoting is well-formed. Every range is parsed
+	// until a row starts at or past the next boundary, so the offset where a range stops
+	// is exact. A range whose speculative start differs from where its predecessor really
+	// stopped is discarded and parsed again from the correct offset, which keeps the rows
+	// each worker sees identical to a single threaded read no matter how odd the quoting.
+	class ParallelCsvParser
+	{
+	public:
+		// Smaller inputs aren't worth splitting, each worker gets at least this many bytes
+		static constexpr std::size_t MIN_CHUNK_SIZE = 1024 * 1024 * 16;
+
+		// Parses input from begin (the start of a row) to the end with up to threads workers
+		ParallelCsvParser(std::string_view input, std::size_t begin, std::size_t threads)
+			: m_input(input), m_begin(std::min(begin, input.size()))
+		{
+			const std::size_t length = m_input.size() - m_begin;
+			m_workers = std::clamp<std::size_t>(length / MIN_CHUNK_SIZE, 1, std::max<std::size_t>(threads, 1));
+		}
+
+		// Change the quote character
+		ParallelCsvParser& quote(char c) noexcept
+		{
+			m_quote = c;
+			return *this;
+		}
+
+		// Change the delimiter character
+		ParallelCsvParser& delimiter(char c) noexcept
+		{
+			m_delimiter = c;
+			return *this;
+		}
+
+		// Only hand back the projected fields, see MappedCsvParser::next_row
+		ParallelCsvParser& project(const Projection& projection)
+		{
+			m_projection = projection;
+			return *this;
+		}
+
+		// Number of ranges the input is split into, worker indexes passed to the callbacks
+		// are below this value
+		[[nodiscard]] std::size_t workers() const
+		{
+			return m_workers;
+		}
+
+		// Calls on_row(worker, row) for every row, rows of one worker are delivered in file
+		// order from a single thread. on_reset(worker) is called from the calling thread
+		// when a worker's speculative range was wrong, anything it accumulated must be
+		// dropped before the range is parsed again.
+		template <typename RowFn, typename ResetFn>
+		void Run(RowFn&& on_row, ResetFn&& on_reset)
+		{
+			if (m_workers == 1)
+			{
+				ParseRange(0, m_begin, m_input.size(), on_row);
+				return;
+			}
+
+			const std::vector<std::size_t> starts = Split();
+			std::vector<std::size_t> stops(m_workers);
+			{
+				std::vector<std::jthread> threads;
+				threads.reserve(m_workers);
+				for (std::size_t i = 0; i < m_workers; ++i)
+				{
+					threads.emplace_back([&, i]
+					{
+						stops[i] = ParseRange(i, starts[i], starts[i + 1], on_row);
+					});
+				}
+			}
+
+			// The first range starts on a known row, every later one is only valid if its
+			// predecessor stopped exactly where it started
+			std::size_t expected = stops[0];
+			for (std::size_t i = 1; i < m_workers; ++i)
+			{
+				if (starts[i] != expected)
+				{
+					on_reset(i);
+					stops[i] = ParseRange(i, expected, starts[i + 1], on_row);
+				}
+				expected = stops[i];
+			}
+		}
+
+	private:
+		// Parses the rows starting before end, returns the offset of the first row not read
+		template <typename RowFn>
+		std::size_t ParseRange(std::size_t worker, std::size_t start, std::size_t end, RowFn& on_row) const
+		{
+			MappedCsvParser parser(m_input);
+			parser.quote(m_quote).delimiter(m_delimiter);
+			parser.seek(start);
+
+			std::vector<std::string_view> fields;
+			std::deque<std::string> unescaped;
+			fields.reserve(64);
+
+			while (parser.position() < end && (m_projection
+				                                   ? parser.next_row(*m_projection, fields, unescaped)
+				                                   : parser.next_row(fields, unescaped)))
+			{
+				on_row(worker, MappedCsvParser::Row(fields.data(), fields.size()));
+			}
+			return parser.position();
+		}
+
+		// Speculative row aligned start offsets, one per worker plus the end of input
+		[[nodiscard]] std::vector<std::size_t> Split() const
+		{
+			const std::size_t length = m_input.size() - m_begin;
+
+			std::vector<std::size_t> nominal(m_workers + 1);
+			for (std::size_t i = 0; i <= m_workers; ++i)
+			{
+				nominal[i] = m_begin + length / m_workers * i;
+			}
+			nominal[m_workers] = m_input.size();
+
+			// Quote parity of every slice, counted in parallel as it touches the whole input
+			std::vector<std::size_t> quotes(m_workers);
+			{
+				std::vector<std::jthread> threads;
+				threads.reserve(m_workers);
+				for (std::size_t i = 0; i < m_workers; ++i)
+				{
+					threads.emplace_back([&, i]
+					{
+						quotes[i] = static_cast<std::size_t>(std::count(
+							m_input.begin() + static_cast<std::ptrdiff_t>(nominal[i]),
+							m_input.begin() + static_cast<std::ptrdiff_t>(nominal[i + 1]), m_quote));
+					});
+				}
+			}
+
+			std::vector<std::size_t> starts(m_workers + 1);
+			starts[0] = m_begin;
+			starts[m_workers] = m_input.size();
+
+			bool in_quote = false;
+			for (std::size_t i = 1; i < m_workers; ++i)
+			{
+				in_quote ^= (quotes[i - 1] & 1) != 0;
+				starts[i] = std::max(starts[i - 1], NextRow(nominal[i], in_quote));
+			}
+			return starts;
+		}
+
+		// First row start after offset given whether offset is inside a quoted field
+		[[nodiscard]] std::size_t NextRow(std::size_t offset, bool in_quote) const
+		{
+			for (; offset < m_input.size(); ++offset)
+			{
+				const char c = m_input[offset];
+				if (c == m_quote)
+				{
+					in_quote = !in_quote;
+				}
+				else if (!in_quote && (c == '\r' || c == '\n'))
+				{
+					if (c == '\r' && offset + 1 < m_input.size() && m_input[offset + 1] == '\n')
+					{
+						++offset;
+					}
+					return offset + 1;
+				}
+			}
+			return m_input.size();
+		}
+
+	private:
+		std::string_view m_input;
+		std::size_t m_begin;
+		std::size_t m_workers;
+		char m_quote = '"';
+		char m_delimiter = ',';
+		std::optional<Projection> m_projection;
+	};
+}
+#endif //SLANALYZER_PARALLELCSVPARSER_H
@@ -0,0 +1,222 @@
+/**
+ * This code was tested against C++20
+ *
+ * @author Ludvik Jerabek
+ * @package slanalyzer
+ * @version 1.0.0
+ * @license MIT
+ */
+#ifndef SLANALYZER_REGEXLITERAL_H
+#define SLANALYZER_REGEXLITERAL_H
+
+#include "Utils.h"
+#include <algorithm>
+#include <cctype>
+#include <string>
+#include <string_view>
+
+namespace Proofpoint
+{
+	// A regex entry which only matches an ASCII literal, ^user@example\.com$ is the literal
+	// user@example.com anchored at both ends and can be looked up by a literal engine.
+	//
+	// RE2 doesn't install its regexp parser, the pattern text is read here instead and only
+	// the forms which are literal beyond doubt are recognized: literal characters, escaped
+	// punctuation, ^ and $ at the ends and .* where it may match nothing, .*foo.* is foo.
+	// Anything else, flags and classes included, stays a regex.
+	struct RegexLiteral
+	{
+		enum class Form
+		{
+			NONE,
+			EXACT,
+			PREFIX,
+			SUFFIX,
+			SUBSTRING
+		};
+
+		Form form = Form::NONE;
+		std::string literal;
+
+		static RegexLiteral Parse(std::string_view pattern)
+		{
+			RegexLiteral result;
+
+			// .* ahead of ^ or behind $ would skip a newline the literal engines don't skip
+			const bool start = pattern.starts_with('^');
+			if (start)
+				pattern.remove_prefix(1);
+			else if (pattern.starts_with(".*"))
+				pattern.remove_prefix(2);
+
+			const bool end = pattern.ends_with('$') && !Escaped(pattern, pattern.size() - 1);
+			if (end)
+				pattern.remove_suffix(1);
+			else if (pattern.ends_with(".*") && !Escaped(pattern, pattern.size() - 2))
+				pattern.remove_suffix(2);
+
+			std::string literal;
+			for (std::size_t i = 0; i < pattern.size(); i++)
+			{
+				const unsigned char c = static_cast<unsigned char>(pattern[i]);
+				if (c & 0x80)
+					return result;
+				if (c == '\\')
+				{
+					// \. is a dot, \d or \x2E are not literal characters
+					if (++i == pattern.size())
+						return result;
+					const unsigned char e = static_cast<unsigned char>(pattern[i]);
+					if ((e & 0x80) || std::isalnum(e) || std::isspace(e))
+						return result;
+					literal.push_back(static_cast<char>(e));
+				}
+				else if (std::string_view(".^$*+?()[]{}|").find(static_cast<char>(c)) != std::string_view::npos)
+				{
+					return result;
+				}
+				else
+				{
+					literal.push_back(static_cast<char>(c));
+				}
+			}
+
+			if (literal.empty())
+				return result;
+
+			result.form = start ? (end ? Form::EXACT : Form::PREFIX) : (end ? Form::SUFFIX : Form::SUBSTRING);
+			result.literal = std::move(literal);
+			return result;
+		}
+
+		// The lowercase ASCII literal any match of a regex ending in $ ends the value with,
+		// empty when there's none. ^.*@(mail|smtp)\.example\.com$ ends every match with
+		// .example.com. Read as conservatively as Parse: a top level |, \Q, (?m) or an escape
+		// it doesn't know give up, anything else which isn't a literal character starts over.
+		static std::string RequiredSuffix(std::string_view pattern)
+		{
+			if (!pattern.ends_with('$') || Escaped(pattern, pattern.size() - 1))
+				return {};
+			pattern.remove_suffix(1);
+
+			std::string literal;
+			int depth = 0;
+			for (std::size_t i = 0; i < pattern.size(); i++)
+			{
+				const unsigned char c = static_cast<unsigned char>(pattern[i]);
+				if (c & 0x80)
+				{
+					literal.clear();
+				}
+				else if (c == '\\')
+				{
+					if (++i == pattern.size())
+						return {};
+					const unsigned char e = static_cast<unsigned char>(pattern[i]);
+					if (!(e & 0x80) && !std::isalnum(e) && !std::isspace(e))
+					{
+						literal.push_back(static_cast<char>(e));
+						continue;
+					}
+
+					// \x41 or \p{Greek} aren't the characters they're spelled with
+					literal.clear();
+					if (e == 'Q')
+						return {};
+					if (e == 'x' || e == 'p' || e == 'P')
+					{
+						if (i + 1 < pattern.size() && pattern[i + 1] == '{')
+						{
+							i = pattern.find('}', i);
+							if (i == std::string_view::npos)
+								return {};
+						}
+						else
+						{
+							i = std::min(i + (e == 'x' ? 2 : 1), pattern.size() - 1);
+						}
+					}
+					else if (std::isdigit(e))
+					{
+						// Octal, up to three digits
+						for (int digits = 1; digits < 3 && i + 1 < pattern.size() &&
+						     std::isdigit(static_cast<unsigned char>(pattern[i + 1])); digits++)
+							i++;
+					}
+				}
+				else if (c == '[')
+				{
+					// A ] right after [ or [^ is a member, not the end
+					literal.clear();
+					std::size_t j = i + 1;
+					if (j < pattern.size() && pattern[j] == '^')
+						j++;
+					if (j < pattern.size() && pattern[j] == ']')
+						j++;
+					for (; j < pattern.size() && pattern[j] != ']'; j++)
+					{
+						if (pattern[j] == '\\')
+							j++;
+					}
+					if (j >= pattern.size())
+						return {};
+					i = j;
+				}
+				else if (c == '(')
+				{
+					literal.clear();
+					depth++;
+					if (i + 1 < pattern.size() && pattern[i + 1] == '?')
+					{
+						// (?flags) or (?flags:...), multi-line lets $ match ahead of a newline
+						const std::size_t end = pattern.find_first_of(":)>", i);
+						if (end == std::string_view::npos)
+							return {};
+						if (pattern.substr(i, end - i).find('m') != std::string_view::npos &&
+						    pattern[i + 2] != 'P')
+							return {};
+						if (pattern[end] == ')')
+							depth--;
+						i = end;
+					}
+				}
+				else if (c == ')')
+				{
+					literal.clear();
+					depth--;
+				}
+				else if (c == '|')
+				{
+					if (depth == 0)
+						return {};
+					literal.clear();
+				}
+				else if (std::string_view(".^$*+?{}").find(static_cast<char>(c)) != std::string_view::npos)
+				{
+					// A quantifier makes the character before it optional too
+					literal.clear();
+				}
+				else
+				{
+					literal.push_back(static_cast<char>(c));
+				}
+			}
+
+			if (depth != 0)
+				return {};
+			std::transform(literal.begin(), literal.end(), literal.begin(), Utils::ascii_lower);
+			return literal;
+		}
+
+	private:
+		// Whether the character at i follows an odd run of backslashes
+		static bool Escaped(std::string_view pattern, std::size_t i)
+		{
+			std::size_t slashes = 0;
+			while (i > slashes && pattern[i - slashes - 1] == '\\')
+				slashes++;
+			return slashes % 2;
+		}
+	};
+}
+#endif //SLANALYZER_REGEXLITERAL_H
@@ -0,0 +1,250 @@
+/**
+ * This code was tested against C++20
+ *
+ * @author Ludvik Jerabek
+ * @package slanalyzer
+ * @version 1.0.0
+ * @license MIT
+ */
+#ifndef SLANALYZER_STRUCTURALINDEX_H
+#define SLANALYZER_STRUCTURALINDEX_H
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace csv
+{
+	// Vectorized structural index in the style of simdjson / simdcsv. Input is classified
+	// 64 bytes at a time into quote and separator (delimiter, '\r', '\n') bitmasks, quote
+	// parity is tracked with a prefix xor so separators inside quoted fields are masked
+	// out, and the remaining separator offsets are flattened into a position buffer the
+	// row iterator walks instead of testing every byte.
+	//
+	// Parity only agrees with the CsvParser state machine for well-formed quoting, so each
+	// block is also checked for quotes the state machine would treat differently: an
+	// opening quote that doesn't start a field, or a closing quote that isn't followed by
+	// a separator or another quote. Separators past the first such quote are not trusted
+	// and the parser falls back to the scalar state machine for that field.
+	class StructuralIndex
+	{
+	public:
+		// Bytes indexed per Build(), small enough for the positions to stay in cache
+		static constexpr std::size_t CHUNK_SIZE = 1024 * 32;
+		static constexpr std::size_t BLOCK_SIZE = 64;
+
+		StructuralIndex(char quote, char delimiter)
+			: m_quote(quote), m_delimiter(delimiter)
+		{
+			// Every byte of a chunk can be a separator, plus slack for the unrolled writes
+			m_positions.resize(CHUNK_SIZE + 8);
+		}
+
+		// Indexes up to CHUNK_SIZE bytes starting at begin which must be the start of a field
+		void Build(const char* begin, const char* end)
+		{
+			m_base = begin;
+			m_next = 0;
+			m_count = 0;
+
+			const std::size_t length = std::min<std::size_t>(end - begin, CHUNK_SIZE);
+
+			std::uint64_t in_quote_carry = 0;
+			std::uint64_t prev_separator = 1; // The chunk starts on a field boundary
+			std::uint64_t prev_quote = 0;
+			std::uint64_t prev_close = 0;
+
+			for (std::size_t offset = 0; offset < length; offset += BLOCK_SIZE)
+			{
+				const Masks masks = (length - offset >= BLOCK_SIZE)
+					                    ? Classify(begin + offset)
+					                    : ClassifyTail(begin + offset, length - offset);
+
+				const std::uint64_t in_quote = PrefixXor(masks.quote) ^ in_quote_carry;
+				const std::uint64_t open = masks.quote & in_quote;
+				const std::uint64_t close = masks.quote & ~in_quote;
+
+				// Quotes the parity model disagrees with the state machine on
+				const std::uint64_t after_separator = (masks.separator << 1) | prev_separator;
+				const std::uint64_t after_quote = (masks.quote << 1) | prev_quote;
+				const std::uint64_t after_close = (close << 1) | prev_close;
+				const std::uint64_t invalid = (open & ~(after_separator | after_quote))
+					| (after_close & ~(masks.separator | masks.quote) & Valid(length - offset));
+
+				std::uint64_t separators = masks.separator & ~in_quote;
+
+				if (invalid)
+				{
+					const std::uint64_t first = std::uint64_t{1} << std::countr_zero(invalid);
+					separators &= first - 1;
+				}
+
+				Flatten(separators, static_cast<std::uint32_t>(offset));
+
+				if (invalid)
+				{
+					break;
+				}
+
+				in_quote_carry = static_cast<std::uint64_t>(static_cast<std::int64_t>(in_quote) >> 63);
+				prev_separator = masks.separator >> 63;
+				prev_quote = masks.quote >> 63;
+				prev_close = close >> 63;
+			}
+		}
+
+		// Drops the indexed positions, used when the reader jumps to another part of the input
+		void Clear()
+		{
+			m_base = nullptr;
+			m_next = 0;
+			m_count = 0;
+		}
+
+		// First trusted separator at or after cursor, nullptr when the index holds none
+		const char* Next(const char* cursor)
+		{
+			while (m_next < m_count)
+			{
+				const char* separator = m_base + m_positions[m_next];
+				if (separator >= cursor)
+				{
+					return separator;
+				}
+				++m_next;
+			}
+			return nullptr;
+		}
+
+	private:
+		struct Masks
+		{
+			std::uint64_t quote;
+			std::uint64_t separator;
+		};
+
+		// Appends the offset of every set bit, written eight at a time without branching
+		// on each bit, the slack at the end of the buffer absorbs the overshoot
+		void Flatten(std::uint64_t bits, std::uint32_t offset)
+		{
+			const auto count = static_cast<std::size_t>(std::popcount(bits));
+			std::uint32_t* out = m_positions.data() + m_count;
+
+			for (std::size_t i = 0; i < count; i += 8)
+			{
+				for (std::size_t j = 0; j < 8; ++j)
+				{
+					out[i + j] = offset + static_cast<std::uint32_t>(std::countr_zero(bits));
+					bits &= bits - 1;
+				}
+			}
+
+			m_count += count;
+		}
+
+		// Mask of the first n bits of a block
+		static std::uint64_t Valid(std::size_t n)
+		{
+			return n >= BLOCK_SIZE ? ~std::uint64_t{0} : (std::uint64_t{1} << n) - 1;
+		}
+
+		// Running xor of the quote bits, set bits mark bytes inside a quoted region
+		static std::uint64_t PrefixXor(std::uint64_t bits)
+		{
+#if defined(__PCLMUL__)
+			const __m128i all_ones = _mm_set1_epi8(static_cast<char>(0xFF));
+			return static_cast<std::uint64_t>(
+				_mm_cvtsi128_si64(_mm_clmulepi64_si128(_mm_set_epi64x(0, static_cast<long long>(bits)), all_ones, 0)));
+#else
+			bits ^= bits << 1;
+			bits ^= bits << 2;
+			bits ^= bits << 4;
+			bits ^= bits << 8;
+			bits ^= bits << 16;
+			bits ^= bits << 32;
+			return bits;
+#endif
+		}
+
+		[[nodiscard]] Masks Classify(const char* p) const
+		{
+#if defined(__AVX2__)
+			const __m256i quote = _mm256_set1_epi8(m_quote);
+			const __m256i delimiter = _mm256_set1_epi8(m_delimiter);
+			const __m256i cr = _mm256_set1_epi8('\r');
+			const __m256i lf = _mm256_set1_epi8('\n');
+
+			auto classify = [&](const char* block, std::uint64_t& q, std::uint64_t& s)
+			{
+				const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+				q = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, quote)));
+				s = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(
+					_mm256_cmpeq_epi8(v, delimiter),
+					_mm256_or_si256(_mm256_cmpeq_epi8(v, cr), _mm256_cmpeq_epi8(v, lf)))));
+			};
+
+			std::uint64_t q0, s0, q1, s1;
+			classify(p, q0, s0);
+			classify(p + 32, q1, s1);
+			return {q0 | (q1 << 32), s0 | (s1 << 32)};
+#elif defined(__SSE2__)
+			const __m128i quote = _mm_set1_epi8(m_quote);
+			const __m128i delimiter = _mm_set1_epi8(m_delimiter);
+			const __m128i cr = _mm_set1_epi8('\r');
+			const __m128i lf = _mm_set1_epi8('\n');
+
+			Masks masks{0, 0};
+			for (int i = 0; i < 4; ++i)
+			{
+				const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i * 16));
+				const auto q = static_cast<std::uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)));
+				const auto s = static_cast<std::uint16_t>(_mm_movemask_epi8(_mm_or_si128(
+					_mm_cmpeq_epi8(v, delimiter),
+					_mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, lf)))));
+				masks.quote |= static_cast<std::uint64_t>(q) << (i * 16);
+				masks.separator |= static_cast<std::uint64_t>(s) << (i * 16);
+			}
+			return masks;
+#else
+			return ClassifyScalar(p, BLOCK_SIZE);
+#endif
+		}
+
+		// Final partial block, copied into a padded buffer so the vector loads stay in bounds
+		[[nodiscard]] Masks ClassifyTail(const char* p, std::size_t n) const
+		{
+			char block[BLOCK_SIZE]{};
+			std::memcpy(block, p, n);
+			Masks masks = Classify(block);
+			masks.quote &= Valid(n);
+			masks.separator &= Valid(n);
+			return masks;
+		}
+
+		[[nodiscard]] Masks ClassifyScalar(const char* p, std::size_t n) const
+		{
+			Masks masks{0, 0};
+			for (std::size_t i = 0; i < n; ++i)
+			{
+				const char c = p[i];
+				masks.quote |= static_cast<std::uint64_t>(c == m_quote) << i;
+				masks.separator |= static_cast<std::uint64_t>(c == m_delimiter || c == '\r' || c == '\n') << i;
+			}
+			return masks;
+		}
+
+	private:
+		char m_quote;
+		char m_delimiter;
+		const char* m_base = nullptr;
+		std::size_t m_next = 0;
+		std::size_t m_count = 0;
+		std::vector<std::uint32_t> m_positions;
+	};
+}
+#endif //SLANALYZER_STRUCTURALINDEX_H
@@ -7,30 +7,82 @@
  * @license MIT
  */
 #include "Subnet.h"
-#include "Utils.h"
-#include <cstdlib>
 #include <sys/socket.h>
 #include <netinet/in.h>
-#include "re2/re2.h"
 
-Proofpoint::Subnet::Subnet(const std::string& cidr)
-	: min(0), max(0), wmask(0), hosts(0)
+bool Proofpoint::Subnet::ParseAddress(std::string_view address, in_addr_t& host_order)
 {
-	re2::StringPiece matches[3];
+	if (address.size() < 7 || address.size() > 15)
+		return false;
 
-	if (!cidr_matcher.Match(cidr, 0, cidr.length(), RE2::ANCHOR_BOTH, matches, 3))
-		throw SubnetArgumentException("Invalid CIDR format [" + cidr + "]");
+	uint32_t result = 0;
+	uint32_t octet = 0;
+	unsigned int digits = 0;
+	unsigned int dots = 0;
+	for (char c : address)
+	{
+		const unsigned int digit = static_cast<unsigned char>(c) - static_cast<unsigned int>('0');
+		if (digit < 10)
+		{
+			// Zero may only stand alone, inet_pton rejects octal looking octets
+			if (digits == 1 && octet == 0)
+				return false;
+			octet = octet * 10 + digit;
+			digits++;
+			if (octet > 255)
+				return false;
+		}
+		else if (c == '.' && digits && dots < 3)
+		{
+			result = (result << 8) | octet;
+			octet = 0;
+			digits = 0;
+			dots++;
+		}
+		else
+		{
+			return false;
+		}
+	}
 
-	in_addr net_address = {0};
+	if (dots != 3 || !digits)
+		return false;
 
-	std::string address = Utils::cvt_std_string(matches[1]);
-	if (inet_pton(AF_INET, address.c_str(), &net_address) != 1)
-		throw SubnetArgumentException("Invalid network address format [" + address + "]");
+	host_order = (result << 8) | octet;
+	return true;
+}
 
-	std::string bits = Utils::cvt_std_string(matches[2]);
-	unsigned long b = atoi(bits.c_str());
+bool Proofpoint::Subnet::ParseCidr(std::string_view cidr, in_addr_t& network, uint8_t& bits)
+{
+	const auto slash = cidr.find('/');
+	if (slash == std::string_view::npos || !ParseAddress(cidr.substr(0, slash), network))
+		return false;
 
-	this->net = ntohl(net_address.s_addr);
+	// 0 to 32 without leading zeros
+	const std::string_view prefix = cidr.substr(slash + 1);
+	if (prefix.empty() || prefix.size() > 2 || (prefix.size() == 2 && prefix[0] == '0'))
+		return false;
+
+	unsigned int b = 0;
+	for (char c : prefix)
+	{
+		if (c < '0' || c > '9')
+			return false;
+		b = b * 10 + static_cast<unsigned int>(c - '0');
+	}
+	if (b > 32)
+		return false;
+
+	bits = static_cast<uint8_t>(b);
+	return true;
+}
+
+Proofpoint::Subnet::Subnet(const std::string& cidr)
+	: min(0), max(0), wmask(0), hosts(0)
+{
+	uint8_t b = 0;
+	if (!ParseCidr(cidr, net, b))
+		throw SubnetArgumentException("Invalid CIDR format [" + cidr + "]");
 
 	mask = (b == 0) ? 0 : (0xFFFFFFFFu << (32 - b));
 
@@ -165,21 +217,26 @@ uint32_t Proofpoint::Subnet::GetAddressableHosts() const
 
 bool Proofpoint::Subnet::IsValidIp(const std::string& address)
 {
-	return RE2::FullMatch(address, ip_matcher);
+	in_addr_t host_order = 0;
+	return ParseAddress(address, host_order);
 }
 
 bool Proofpoint::Subnet::IsValidCidr(const std::string& cidr, std::string& network, std::string& bits)
 {
-	re2::StringPiece matches[3];
-	if (!cidr_matcher.Match(cidr, 0, cidr.length(), RE2::ANCHOR_BOTH, matches, 3)) return false;
-	network = Utils::cvt_std_string(matches[1]);
-	bits = Utils::cvt_std_string(matches[2]);
+	in_addr_t address = 0;
+	uint8_t b = 0;
+	if (!ParseCidr(cidr, address, b)) return false;
+	const auto slash = cidr.find('/');
+	network = cidr.substr(0, slash);
+	bits = cidr.substr(slash + 1);
 	return true;
 }
 
 bool Proofpoint::Subnet::IsValidCidr(const std::string& cidr)
 {
-	return RE2::FullMatch(cidr, cidr_matcher);
+	in_addr_t address = 0;
+	uint8_t b = 0;
+	return ParseCidr(cidr, address, b);
 }
 
 std::string Proofpoint::Subnet::GetAddress(in_addr_t address, Proofpoint::Subnet::ByteOrder order)
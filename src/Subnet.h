@@ -10,8 +10,10 @@
 #define SLANALYZER_SUBNET_H
 
 #include <arpa/inet.h>
+#include <cstdint>
 #include <stdexcept>
-#include "re2/re2.h"
+#include <string>
+#include <string_view>
 
 namespace Proofpoint
 {
@@ -30,6 +32,11 @@ namespace Proofpoint
 		};
 
 	public:
+		// Four decimal octets without leading zeros, the addresses inet_pton accepts, as a host
+		// order address. Doesn't allocate or need a null terminated string.
+		static bool ParseAddress(std::string_view address, in_addr_t& host_order);
+		// Address and prefix length such as 10.1.0.0/16, network is the address as written
+		static bool ParseCidr(std::string_view cidr, in_addr_t& network, uint8_t& bits);
 		static bool IsValidIp(const std::string& address);
 		static bool IsValidCidr(const std::string& cidr, std::string& network, std::string& bits);
 		static bool IsValidCidr(const std::string& cidr);
@@ -51,9 +58,9 @@ namespace Proofpoint
 
 		inline bool InSubnet(const std::string& ip_address) const
 		{
-			in_addr address{0};
-			if (inet_pton(AF_INET, ip_address.c_str(), &address) == 0) return false;
-			return !((ntohl(address.s_addr) ^ net) & mask);
+			in_addr_t address = 0;
+			if (!ParseAddress(ip_address, address)) return false;
+			return !((address ^ net) & mask);
 		}
 
 		[[nodiscard]] std::string GetNet() const;
@@ -70,12 +77,6 @@ namespace Proofpoint
 		[[nodiscard]] in_addr_t GetWildcardAddress(ByteOrder order = HOST) const;
 		[[nodiscard]] uint32_t GetAddressableHosts() const;
 
-	private:
-		inline static RE2 ip_matcher =
-			R"(^((25[0-5]|2[0-4][0-9]|[01]?[0-9][0-9]?)\.){3}(25[0-5]|2[0-4][0-9]|[01]?[0-9][0-9]?)$)";
-		inline static RE2 cidr_matcher =
-			R"(^((?:(?:25[0-5]|2[0-4][0-9]|[01]?[0-9][0-9]?)\.){3}(?:25[0-5]|2[0-4][0-9]|[01]?[0-9][0-9]?))(?:\/)((?:3[0-2]|2[0-9]|1[0-9]|[0-9]))$)";
-
 	private:
 		// Network Address (host order)
 		in_addr_t net;
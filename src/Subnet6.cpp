@@ -0,0 +1,84 @@
+/**
+ * This code was tested against C++20
+ *
+ * @author Ludvik Jerabek
+ * @package slanalyzer
+ * @version 1.0.0
+ * @license MIT
+ */
+#include "Subnet6.h"
+#include <arpa/inet.h>
+
+bool Proofpoint::Subnet6::ParseAddress(std::string_view address, Address6& parsed)
+{
+	// inet_pton requires a null terminated address
+	char text[INET6_ADDRSTRLEN]{};
+	if (address.size() >= sizeof(text))
+		return false;
+	address.copy(text, address.size());
+
+	unsigned char bytes[16];
+	if (inet_pton(AF_INET6, text, bytes) != 1)
+		return false;
+
+	parsed = {0, 0};
+	for (int i = 0; i < 8; i++)
+	{
+		parsed.hi = (parsed.hi << 8) | bytes[i];
+		parsed.lo = (parsed.lo << 8) | bytes[i + 8];
+	}
+	return true;
+}
+
+std::string Proofpoint::Subnet6::GetAddress(const Address6& address)
+{
+	unsigned char bytes[16];
+	for (int i = 0; i < 8; i++)
+	{
+		bytes[i] = static_cast<unsigned char>(address.hi >> (56 - 8 * i));
+		bytes[i + 8] = static_cast<unsigned char>(address.lo >> (56 - 8 * i));
+	}
+
+	char s[INET6_ADDRSTRLEN];
+	inet_ntop(AF_INET6, bytes, s, INET6_ADDRSTRLEN);
+	return s;
+}
+
+bool Proofpoint::Subnet6::IsV4Mapped(const Address6& address, uint32_t& ipv4)
+{
+	if (address.hi != 0 || (address.lo >> 32) != 0xFFFFu)
+		return false;
+	ipv4 = static_cast<uint32_t>(address.lo);
+	return true;
+}
+
+Proofpoint::Subnet6::Subnet6(const std::string& cidr)
+{
+	const auto slash = cidr.find('/');
+	if (slash == std::string::npos)
+		throw SubnetArgumentException("Invalid CIDR format [" + cidr + "]");
+
+	// 0 to 128 without leading zeros, as Subnet::ParseCidr reads IPv4 prefixes
+	const std::string_view bits(cidr.data() + slash + 1, cidr.size() - slash - 1);
+	if (bits.empty() || bits.size() > 3 || (bits.size() > 1 && bits[0] == '0'))
+		throw SubnetArgumentException("Invalid CIDR format [" + cidr + "]");
+
+	unsigned int b = 0;
+	for (char c : bits)
+	{
+		if (c < '0' || c > '9')
+			throw SubnetArgumentException("Invalid CIDR format [" + cidr + "]");
+		b = b * 10 + static_cast<unsigned int>(c - '0');
+	}
+	if (b > 128)
+		throw SubnetArgumentException("Invalid CIDR format [" + cidr + "]");
+
+	if (!ParseAddress(std::string_view(cidr.data(), slash), net))
+		throw SubnetArgumentException("Invalid network address format [" + cidr.substr(0, slash) + "]");
+
+	prefix_length = static_cast<uint8_t>(b);
+	mask.hi = (b == 0) ? 0 : (b >= 64) ? ~uint64_t{0} : (~uint64_t{0} << (64 - b));
+	mask.lo = (b <= 64) ? 0 : (b == 128) ? ~uint64_t{0} : (~uint64_t{0} << (128 - b));
+	net.hi &= mask.hi;
+	net.lo &= mask.lo;
+}
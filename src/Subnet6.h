@@ -0,0 +1,65 @@
+/**
+ * This code was tested against C++20
+ *
+ * @author Ludvik Jerabek
+ * @package slanalyzer
+ * @version 1.0.0
+ * @license MIT
+ */
+#ifndef SLANALYZER_SUBNET6_H
+#define SLANALYZER_SUBNET6_H
+
+#include "Subnet.h"
+#include <compare>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace Proofpoint
+{
+	// IPv6 address as two host order halves, compares in address order
+	struct Address6
+	{
+		uint64_t hi;
+		uint64_t lo;
+
+		auto operator<=>(const Address6&) const = default;
+	};
+
+	class Subnet6
+	{
+	public:
+		using SubnetArgumentException = Subnet::SubnetArgumentException;
+
+	public:
+		// Parses an IPv6 address without allocating, false when address isn't one
+		static bool ParseAddress(std::string_view address, Address6& parsed);
+		static std::string GetAddress(const Address6& address);
+		// Whether address is IPv4 mapped (::ffff:a.b.c.d), ipv4 gets the IPv4 address in host order
+		static bool IsV4Mapped(const Address6& address, uint32_t& ipv4);
+
+	public:
+		// Network address and prefix length such as 2001:db8::/32
+		explicit Subnet6(const std::string& cidr);
+
+		inline bool InSubnet(const Address6& address) const
+		{
+			return !(((address.hi ^ net.hi) & mask.hi) | ((address.lo ^ net.lo) & mask.lo));
+		}
+
+		[[nodiscard]] std::string GetNet() const { return GetAddress(net); }
+		[[nodiscard]] std::string GetMask() const { return GetAddress(mask); }
+		[[nodiscard]] Address6 GetNetAddress() const { return net; }
+		[[nodiscard]] Address6 GetMaskAddress() const { return mask; }
+		[[nodiscard]] Address6 GetWildcardAddress() const { return {~mask.hi, ~mask.lo}; }
+		// Last address in the subnet
+		[[nodiscard]] Address6 GetMaxAddress() const { return {net.hi | ~mask.hi, net.lo | ~mask.lo}; }
+		[[nodiscard]] uint8_t GetPrefixLength() const { return prefix_length; }
+
+	private:
+		Address6 net;
+		Address6 mask;
+		uint8_t prefix_length;
+	};
+}
+#endif //SLANALYZER_SUBNET6_H
@@ -14,27 +14,56 @@
 #include "Utils.h"
 
 #include <memory>
-#include <unordered_map>
+#include <span>
+#include <vector>
 #include <iostream>
 
 namespace Proofpoint
 {
     template <typename T>
-    class SubnetMatcher : public IMatcher<T>
+    class SubnetMatcher final : public IMatcher<T>
     {
+    public:
+        explicit SubnetMatcher(SubnetSet::Layout layout = SubnetSet::Layout::POPTRIE) : layout(layout)
+        {
+        }
+
     public:
         void Add(const std::string& pattern,
                  const T& index,
                  PatternErrors<T>& pattern_errors) override;
 
-        bool Match(const std::string& pattern,
-                   std::vector<T>& match_indexes) override;
+        // Freezes the subnet set into its lookup layout
+        void Compile(PatternErrors<T>&) override
+        {
+            subnet_set.Freeze(layout);
+        }
+
+        bool Match(std::string_view pattern,
+                   std::vector<T>& match_indexes,
+                   MatchScratch<T>& scratch) const override;
+
+        // Same as above for an address the caller already parsed
+        bool Match(const IpAddress& address,
+                   std::vector<T>& match_indexes,
+                   MatchScratch<T>& scratch) const;
 
-        std::size_t GetPatternCount() override;
+        // Matches many IPv4 addresses at once, the entries of addresses[i] end up in
+        // match_indexes[offsets[i]] up to match_indexes[offsets[i + 1]]
+        void MatchBatch(std::span<const uint32_t> addresses,
+                        std::vector<uint32_t>& offsets,
+                        std::vector<T>& match_indexes,
+                        MatchScratch<T>& scratch) const;
+
+        std::size_t GetPatternCount() const override;
+
+        std::vector<T> GetPatternIndexes() const override;
 
     private:
+        SubnetSet::Layout layout;
         SubnetSet subnet_set;
-        std::unordered_map<int, T> map_to_list_entry;
+        // Entry index of each CIDR id, the subnet set numbers the CIDRs it accepts from zero
+        std::vector<T> map_to_list_entry;
     };
 
     template <typename T>
@@ -54,38 +83,65 @@ namespace Proofpoint
                 continue;
             }
 
-            map_to_list_entry.insert({id, index});
+            map_to_list_entry.push_back(index);
         }
     }
 
     template <typename T>
-    bool SubnetMatcher<T>::Match(const std::string& pattern,
-                                 std::vector<T>& match_indexes)
+    bool SubnetMatcher<T>::Match(std::string_view pattern,
+                                 std::vector<T>& match_indexes,
+                                 MatchScratch<T>& scratch) const
+    {
+        return Match(IpAddress::Parse(pattern), match_indexes, scratch);
+    }
+
+    template <typename T>
+    bool SubnetMatcher<T>::Match(const IpAddress& address,
+                                 std::vector<T>& match_indexes,
+                                 MatchScratch<T>& scratch) const
     {
         match_indexes.clear();
 
-        std::vector<int> matches;
+        std::vector<int>& matches = scratch.ids;
 
-        if (!subnet_set.Match(pattern, &matches))
+        if (!subnet_set.Match(address, &matches))
         {
             return false;
         }
 
         for (int id : matches)
         {
-            auto it = map_to_list_entry.find(id);
-
-            if (it != map_to_list_entry.end())
-            {
-                match_indexes.emplace_back(it->second);
-            }
+            match_indexes.emplace_back(map_to_list_entry[id]);
         }
 
         return !match_indexes.empty();
     }
 
     template <typename T>
-    std::size_t SubnetMatcher<T>::GetPatternCount()
+    void SubnetMatcher<T>::MatchBatch(std::span<const uint32_t> addresses,
+                                      std::vector<uint32_t>& offsets,
+                                      std::vector<T>& match_indexes,
+                                      MatchScratch<T>& scratch) const
+    {
+        subnet_set.MatchBatch(addresses, offsets, scratch.ids);
+
+        match_indexes.clear();
+
+        for (int id : scratch.ids)
+        {
+            match_indexes.emplace_back(map_to_list_entry[id]);
+        }
+    }
+
+    template <typename T>
+    std::vector<T> SubnetMatcher<T>::GetPatternIndexes() const
+    {
+        // An entry listing several CIDRs has one index per CIDR
+        return map_to_list_entry;
+    }
+
+    template <typename T>
+    std::size_t SubnetMatcher<T>::GetPatternCount() const
     {
         return subnet_set.Size();
     }
@@ -9,19 +9,166 @@
 
 #include "SubnetSet.h"
 
-#include <arpa/inet.h>
+#include <algorithm>
+#include <bit>
 #include <exception>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <tuple>
 
 namespace Proofpoint
 {
+    namespace
+    {
+        // Address following address, false past the last address
+        bool Successor(uint32_t address, uint32_t& next)
+        {
+            if (address == UINT32_MAX)
+            {
+                return false;
+            }
+
+            next = address + 1;
+            return true;
+        }
+
+        bool Successor(const Address6& address, Address6& next)
+        {
+            if (address.lo != UINT64_MAX)
+            {
+                next = {address.hi, address.lo + 1};
+                return true;
+            }
+
+            if (address.hi == UINT64_MAX)
+            {
+                return false;
+            }
+
+            next = {address.hi + 1, 0};
+            return true;
+        }
+
+        // Splits the address space into the intervals over which the set of matching CIDRs
+        // stays the same from the first and last address of each CIDR. starts[i] begins
+        // interval i which maps onto the set add_set returned for its ids.
+        template <typename Key, typename AddSet>
+        void BuildIntervals(const std::vector<std::tuple<Key, Key, int>>& ranges, AddSet&& add_set,
+                            std::vector<Key>& starts, std::vector<uint32_t>& interval_sets)
+        {
+            // CIDRs entering at an address and leaving at one, a CIDR ending on the last
+            // address never leaves
+            std::vector<std::pair<Key, int>> enter;
+            std::vector<std::pair<Key, int>> leave;
+
+            for (const auto& [first, last, id] : ranges)
+            {
+                enter.emplace_back(first, id);
+                Key next{};
+
+                if (Successor(last, next))
+                {
+                    leave.emplace_back(next, id);
+                }
+            }
+
+            std::sort(enter.begin(), enter.end());
+            std::sort(leave.begin(), leave.end());
+
+            starts.clear();
+            interval_sets.clear();
+
+            std::set<int> active;
+            std::vector<int> ids;
+            std::size_t e = 0;
+            std::size_t l = 0;
+            Key address{};
+
+            for (;;)
+            {
+                for (; e < enter.size() && enter[e].first == address; ++e)
+                {
+                    active.insert(enter[e].second);
+                }
+
+                for (; l < leave.size() && leave[l].first == address; ++l)
+                {
+                    active.erase(leave[l].second);
+                }
+
+                ids.assign(active.begin(), active.end());
+                const uint32_t set = add_set(ids);
+
+                // Neighbouring intervals with the same set are one interval
+                if (interval_sets.empty() || interval_sets.back() != set)
+                {
+                    starts.push_back(address);
+                    interval_sets.push_back(set);
+                }
+
+                if (e == enter.size() && l == leave.size())
+                {
+                    break;
+                }
+
+                if (l == leave.size() || (e < enter.size() && enter[e].first < leave[l].first))
+                {
+                    address = enter[e].first;
+                }
+                else
+                {
+                    address = leave[l].first;
+                }
+            }
+
+            starts.shrink_to_fit();
+            interval_sets.shrink_to_fit();
+        }
+    }
+
+    std::optional<SubnetSet::Layout> SubnetSet::GetLayout(std::string_view layout)
+    {
+        for (std::size_t i = 0; i < std::size(LayoutStrings); ++i)
+        {
+            if (layout == LayoutStrings[i])
+            {
+                return static_cast<Layout>(i);
+            }
+        }
+
+        return std::nullopt;
+    }
+
+    const std::string& SubnetSet::GetLayoutString(Layout layout)
+    {
+        return LayoutStrings[static_cast<std::size_t>(layout)];
+    }
+
     int SubnetSet::Add(const std::string& cidr, std::string* error)
     {
         try
         {
+            if (frozen)
+            {
+                throw std::logic_error("Subnet set is frozen");
+            }
+
+            if (cidr.find(':') != std::string::npos)
+            {
+                Subnet6 subnet(cidr);
+                const int id = next_id++;
+                rules6.push_back(Rule6{subnet, id});
+                return id;
+            }
+
+            Subnet subnet(cidr);
+
+            // Ids are only handed out to valid CIDRs so they stay dense
             const int id = next_id++;
 
             rules.emplace_back(ExactRule{
-                .subnet = Subnet(cidr),
+                .subnet = subnet,
                 .id = id,
                 .prefix_length = 0
             });
@@ -46,21 +193,34 @@ namespace Proofpoint
         }
     }
 
-    bool SubnetSet::Match(const std::string& ip, std::vector<int>* matches) const
+    bool SubnetSet::Match(std::string_view ip, std::vector<int>* matches) const
+    {
+        return Match(IpAddress::Parse(ip), matches);
+    }
+
+    bool SubnetSet::Match(const IpAddress& ip, std::vector<int>* matches) const
     {
         if (matches)
         {
             matches->clear();
         }
 
-        in_addr addr{};
-
-        if (inet_pton(AF_INET, ip.c_str(), &addr) != 1)
+        switch (ip.family)
+        {
+        case IpAddress::Family::V4:
+            return Lookup(ip.v4, matches);
+        case IpAddress::Family::V6:
         {
-            return false;
+            uint32_t ipv4 = 0;
+            bool matched = Subnet6::IsV4Mapped(ip.v6, ipv4) && Lookup(ipv4, matches);
+            matched |= Lookup(ip.v6, matches);
+            return matched;
+        }
+        case IpAddress::Family::NONE:
+            break;
         }
 
-        return Match(ntohl(addr.s_addr), matches);
+        return false;
     }
 
     bool SubnetSet::Match(uint32_t ip_host_order, std::vector<int>* matches) const
@@ -70,6 +230,196 @@ namespace Proofpoint
             matches->clear();
         }
 
+        return Lookup(ip_host_order, matches);
+    }
+
+    bool SubnetSet::Match(const Address6& ip, std::vector<int>* matches) const
+    {
+        if (matches)
+        {
+            matches->clear();
+        }
+
+        return Lookup(ip, matches);
+    }
+
+    bool SubnetSet::Lookup(const Address6& ip, std::vector<int>* matches) const
+    {
+        if (frozen)
+        {
+            const auto interval = std::upper_bound(starts6.begin(), starts6.end(), ip) - starts6.begin() - 1;
+            return MatchSet(sets6[interval], matches);
+        }
+
+        bool matched = false;
+
+        for (const Rule6& rule : rules6)
+        {
+            if (rule.subnet.InSubnet(ip))
+            {
+                matched = true;
+
+                if (matches)
+                {
+                    matches->push_back(rule.id);
+                }
+            }
+        }
+
+        return matched;
+    }
+
+    bool SubnetSet::Lookup(uint32_t ip_host_order, std::vector<int>* matches) const
+    {
+        switch (layout)
+        {
+        case Layout::DIR_24_8:
+        {
+            uint32_t entry = tbl24[ip_host_order >> 8];
+
+            if (entry & TBL8_FLAG)
+            {
+                entry = tbl8[((entry & ~TBL8_FLAG) << 8) | (ip_host_order & 0xFFu)];
+            }
+
+            return MatchSet(entry, matches);
+        }
+        case Layout::POPTRIE:
+        {
+            uint32_t index = 0;
+            uint8_t offset = 0;
+
+            for (;;)
+            {
+                const PoptrieNode& node = nodes[index];
+                const uint8_t stride = offset < 30 ? 6 : 2;
+                const uint32_t v = (ip_host_order >> (32 - offset - stride)) & ((1u << stride) - 1);
+                const uint64_t bit = uint64_t{1} << v;
+                const uint64_t below = (bit << 1) - 1;
+
+                if (!(node.vector & bit))
+                {
+                    return MatchSet(leaves[node.base0 + std::popcount(node.leafvec & below) - 1], matches);
+                }
+
+                index = node.base1 + std::popcount(node.vector & below) - 1;
+                offset += stride;
+            }
+        }
+        case Layout::TRIE:
+            break;
+        }
+
+        return MatchTrie(ip_host_order, matches);
+    }
+
+    void SubnetSet::MatchBatch(std::span<const uint32_t> addresses, std::vector<uint32_t>& offsets,
+                               std::vector<int>& ids) const
+    {
+        offsets.assign(1, 0);
+        ids.clear();
+
+        if (layout == Layout::TRIE)
+        {
+            for (uint32_t address : addresses)
+            {
+                MatchTrie(address, &ids);
+                offsets.push_back(static_cast<uint32_t>(ids.size()));
+            }
+
+            return;
+        }
+
+        uint32_t sets[BATCH_LANES];
+
+        for (std::size_t first = 0; first < addresses.size(); first += BATCH_LANES)
+        {
+            const std::size_t count = std::min(BATCH_LANES, addresses.size() - first);
+
+            if (layout == Layout::DIR_24_8)
+            {
+                ResolveDir24(addresses.data() + first, count, sets);
+            }
+            else
+            {
+                ResolvePoptrie(addresses.data() + first, count, sets);
+            }
+
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                MatchSet(sets[i], &ids);
+                offsets.push_back(static_cast<uint32_t>(ids.size()));
+            }
+        }
+    }
+
+    void SubnetSet::ResolveDir24(const uint32_t* addresses, std::size_t count, uint32_t* sets) const
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            __builtin_prefetch(&tbl24[addresses[i] >> 8]);
+        }
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            sets[i] = tbl24[addresses[i] >> 8];
+
+            if (sets[i] & TBL8_FLAG)
+            {
+                __builtin_prefetch(&tbl8[((sets[i] & ~TBL8_FLAG) << 8) | (addresses[i] & 0xFFu)]);
+            }
+        }
+
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (sets[i] & TBL8_FLAG)
+            {
+                sets[i] = tbl8[((sets[i] & ~TBL8_FLAG) << 8) | (addresses[i] & 0xFFu)];
+            }
+        }
+    }
+
+    void SubnetSet::ResolvePoptrie(const uint32_t* addresses, std::size_t count, uint32_t* sets) const
+    {
+        // Node and bit offset each lane has reached, lanes which found their leaf are done
+        uint32_t index[BATCH_LANES]{};
+        uint8_t offset[BATCH_LANES]{};
+        bool done[BATCH_LANES]{};
+        std::size_t pending = count;
+
+        while (pending)
+        {
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                if (done[i])
+                {
+                    continue;
+                }
+
+                const PoptrieNode& node = nodes[index[i]];
+                const uint8_t stride = offset[i] < 30 ? 6 : 2;
+                const uint32_t v = (addresses[i] >> (32 - offset[i] - stride)) & ((1u << stride) - 1);
+                const uint64_t bit = uint64_t{1} << v;
+                const uint64_t below = (bit << 1) - 1;
+
+                if (!(node.vector & bit))
+                {
+                    sets[i] = leaves[node.base0 + std::popcount(node.leafvec & below) - 1];
+                    done[i] = true;
+                    --pending;
+                    continue;
+                }
+
+                index[i] = node.base1 + std::popcount(node.vector & below) - 1;
+                offset[i] += stride;
+                __builtin_prefetch(&nodes[index[i]]);
+            }
+        }
+    }
+
+    bool SubnetSet::MatchTrie(uint32_t ip_host_order, std::vector<int>* matches) const
+    {
+        bool matched = false;
         const auto octets = ToOctets(ip_host_order);
         const TrieNode* node = &root;
 
@@ -77,6 +427,8 @@ namespace Proofpoint
         {
             for (const ExactRule* rule : node->exact_rules)
             {
+                matched = true;
+
                 if (matches)
                 {
                     matches->push_back(rule->id);
@@ -94,6 +446,8 @@ namespace Proofpoint
             {
                 if (MatchesPartial(next_octet, partial))
                 {
+                    matched = true;
+
                     if (matches)
                     {
                         matches->push_back(partial.rule->id);
@@ -111,12 +465,223 @@ namespace Proofpoint
             node = child.get();
         }
 
-        return matches && !matches->empty();
+        return matched;
+    }
+
+    bool SubnetSet::MatchSet(uint32_t set, std::vector<int>* matches) const
+    {
+        if (matches)
+        {
+            matches->insert(matches->end(), set_ids.begin() + set_offsets[set], set_ids.begin() + set_offsets[set + 1]);
+        }
+
+        return set != 0;
+    }
+
+    void SubnetSet::Freeze(Layout frozen_layout)
+    {
+        if (frozen)
+        {
+            return;
+        }
+
+        frozen = true;
+        layout = frozen_layout;
+
+        // Sets are shared by both address families, set 0 is the empty set
+        std::map<std::vector<int>, uint32_t> set_index{{{}, 0}};
+        set_offsets = {0, 0};
+        set_ids.clear();
+
+        auto add_set = [this, &set_index](const std::vector<int>& ids)
+        {
+            auto [it, added] = set_index.try_emplace(ids, static_cast<uint32_t>(set_index.size()));
+
+            if (added)
+            {
+                set_ids.insert(set_ids.end(), ids.begin(), ids.end());
+                set_offsets.push_back(static_cast<uint32_t>(set_ids.size()));
+            }
+
+            return it->second;
+        };
+
+        std::vector<std::tuple<Address6, Address6, int>> ranges6;
+
+        for (const Rule6& rule : rules6)
+        {
+            ranges6.emplace_back(rule.subnet.GetNetAddress(), rule.subnet.GetMaxAddress(), rule.id);
+        }
+
+        BuildIntervals(ranges6, add_set, starts6, sets6);
+        rules6 = {};
+
+        if (layout == Layout::TRIE)
+        {
+            return;
+        }
+
+        std::vector<std::tuple<uint32_t, uint32_t, int>> ranges;
+
+        for (const ExactRule& rule : rules)
+        {
+            const uint32_t mask = rule.subnet.GetMaskAddress(Subnet::HOST);
+            const uint32_t first = rule.subnet.GetNetAddress(Subnet::HOST) & mask;
+            ranges.emplace_back(first, first | ~mask, rule.id);
+        }
+
+        std::vector<uint32_t> starts;
+        std::vector<uint32_t> interval_sets;
+        BuildIntervals(ranges, add_set, starts, interval_sets);
+
+        if (layout == Layout::DIR_24_8)
+        {
+            BuildDir24(starts, interval_sets);
+        }
+        else
+        {
+            BuildPoptrie(starts, interval_sets);
+        }
+
+        // Lookups only go through the flat form from here on
+        for (auto& child : root.children)
+        {
+            child.reset();
+        }
+
+        root.exact_rules = {};
+        root.partial_rules = {};
+        rules.clear();
+    }
+
+    void SubnetSet::BuildDir24(const std::vector<uint32_t>& starts, const std::vector<uint32_t>& interval_sets)
+    {
+        tbl24.assign(std::size_t{1} << 24, 0);
+        tbl8.clear();
+
+        std::size_t interval = 0;
+
+        for (uint32_t block = 0; block < (1u << 24); ++block)
+        {
+            const uint32_t first = block << 8;
+            const uint32_t last = first | 0xFFu;
+
+            while (interval + 1 < starts.size() && starts[interval + 1] <= first)
+            {
+                ++interval;
+            }
+
+            if (interval + 1 == starts.size() || starts[interval + 1] > last)
+            {
+                tbl24[block] = interval_sets[interval];
+                continue;
+            }
+
+            tbl24[block] = TBL8_FLAG | static_cast<uint32_t>(tbl8.size() >> 8);
+
+            for (uint32_t host = 0; host < 256; ++host)
+            {
+                while (interval + 1 < starts.size() && starts[interval + 1] <= (first | host))
+                {
+                    ++interval;
+                }
+
+                tbl8.push_back(interval_sets[interval]);
+            }
+        }
+    }
+
+    void SubnetSet::BuildPoptrie(const std::vector<uint32_t>& starts, const std::vector<uint32_t>& interval_sets)
+    {
+        nodes.assign(1, PoptrieNode{0, 0, 0, 0});
+        leaves.clear();
+        BuildPoptrieNode(0, 0, 0, starts, interval_sets);
+        nodes.shrink_to_fit();
+        leaves.shrink_to_fit();
+    }
+
+    void SubnetSet::BuildPoptrieNode(uint32_t node, uint32_t base, uint8_t offset,
+                                     const std::vector<uint32_t>& starts, const std::vector<uint32_t>& interval_sets)
+    {
+        const uint8_t stride = offset < 30 ? 6 : 2;
+        const uint64_t span = uint64_t{1} << (32 - offset - stride);
+
+        uint64_t vector = 0;
+        uint64_t leafvec = 0;
+        std::vector<uint32_t> children;
+        std::vector<uint32_t> runs;
+
+        for (uint32_t v = 0; v < (1u << stride); ++v)
+        {
+            const uint32_t first = base + static_cast<uint32_t>(v * span);
+            const uint32_t last = static_cast<uint32_t>(first + span - 1);
+            const std::size_t interval = std::upper_bound(starts.begin(), starts.end(), first) - starts.begin() - 1;
+
+            if (interval + 1 < starts.size() && starts[interval + 1] <= last)
+            {
+                vector |= uint64_t{1} << v;
+                children.push_back(first);
+                continue;
+            }
+
+            // A leaf only starts a run when its set differs from the leaf before it
+            if (runs.empty() || runs.back() != interval_sets[interval])
+            {
+                leafvec |= uint64_t{1} << v;
+                runs.push_back(interval_sets[interval]);
+            }
+        }
+
+        const auto base1 = static_cast<uint32_t>(nodes.size());
+        nodes[node] = PoptrieNode{vector, leafvec, static_cast<uint32_t>(leaves.size()), base1};
+        leaves.insert(leaves.end(), runs.begin(), runs.end());
+        nodes.resize(nodes.size() + children.size(), PoptrieNode{0, 0, 0, 0});
+
+        for (std::size_t i = 0; i < children.size(); ++i)
+        {
+            BuildPoptrieNode(base1 + static_cast<uint32_t>(i), children[i], offset + stride, starts, interval_sets);
+        }
     }
 
     std::size_t SubnetSet::Size() const
     {
-        return rules.size();
+        return static_cast<std::size_t>(next_id);
+    }
+
+    std::size_t SubnetSet::MemoryUsage() const
+    {
+        const std::size_t sets = set_offsets.capacity() * sizeof(uint32_t) + set_ids.capacity() * sizeof(int)
+            + starts6.capacity() * sizeof(Address6) + sets6.capacity() * sizeof(uint32_t)
+            + rules6.capacity() * sizeof(Rule6);
+
+        switch (layout)
+        {
+        case Layout::DIR_24_8:
+            return sets + (tbl24.capacity() + tbl8.capacity()) * sizeof(uint32_t);
+        case Layout::POPTRIE:
+            return sets + nodes.capacity() * sizeof(PoptrieNode) + leaves.capacity() * sizeof(uint32_t);
+        case Layout::TRIE:
+            break;
+        }
+
+        return sets + MemoryUsage(root) + rules.size() * sizeof(ExactRule);
+    }
+
+    std::size_t SubnetSet::MemoryUsage(const TrieNode& node)
+    {
+        std::size_t bytes = sizeof(TrieNode)
+            + node.exact_rules.capacity() * sizeof(const ExactRule*)
+            + node.partial_rules.capacity() * sizeof(PartialRule);
+
+        for (const auto& child : node.children)
+        {
+            if (child)
+            {
+                bytes += MemoryUsage(*child);
+            }
+        }
+
+        return bytes;
     }
 
     void SubnetSet::Insert(ExactRule* rule)
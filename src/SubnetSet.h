@@ -11,30 +11,74 @@
 #define SLANALYZER_SUBNETSET_H
 
 #include "Subnet.h"
+#include "Subnet6.h"
+#include "IpAddress.h"
 
 #include <array>
 #include <cstdint>
 #include <deque>
 #include <memory>
+#include <optional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace Proofpoint
 {
     class SubnetSet
     {
+    public:
+        // How a frozen set is laid out for lookups
+        enum class Layout
+        {
+            // The octet trie CIDRs are added to, kept as is
+            TRIE,
+            // A 2^24 entry table on the top 24 bits plus 256 entry blocks for the /24s CIDRs
+            // split, one or two memory accesses per lookup at 64 MB. Suits large lists.
+            DIR_24_8,
+            // Poptrie, 6 bit strides with bitmaps and popcount indexing into packed children
+            // and leaves. A few KB for small lists and usually four to six memory accesses.
+            POPTRIE
+        };
+
+        static std::optional<Layout> GetLayout(std::string_view layout);
+        static const std::string& GetLayoutString(Layout layout);
+
     public:
         SubnetSet() = default;
 
+        // Takes IPv4 and IPv6 CIDRs, both share one id space
         int Add(const std::string& cidr, std::string* error);
 
-        bool Match(const std::string& ip, std::vector<int>* matches) const;
+        // Builds the lookup structure of layout, CIDRs can't be added afterwards. Every address
+        // maps onto the set of CIDRs containing it, both flat layouts store an index into the
+        // distinct sets so multiple matching CIDRs are reported like the trie reports them.
+        void Freeze(Layout layout);
+
+        // An IPv4 mapped IPv6 address (::ffff:a.b.c.d) matches IPv4 CIDRs as well
+        bool Match(std::string_view ip, std::vector<int>* matches) const;
+
+        bool Match(const IpAddress& ip, std::vector<int>* matches) const;
 
         bool Match(uint32_t ip_host_order, std::vector<int>* matches) const;
 
+        bool Match(const Address6& ip, std::vector<int>* matches) const;
+
+        // Looks up many IPv4 addresses at once, the ids of addresses[i] end up in
+        // ids[offsets[i]] up to ids[offsets[i + 1]]. The flat layouts walk a block of addresses
+        // a level at a time and prefetch the next level, so the cache misses of the block
+        // overlap instead of following one another.
+        void MatchBatch(std::span<const uint32_t> addresses, std::vector<uint32_t>& offsets,
+                        std::vector<int>& ids) const;
+
         [[nodiscard]]
         std::size_t Size() const;
 
+        // Bytes held by the lookup structure of the current layout
+        [[nodiscard]]
+        std::size_t MemoryUsage() const;
+
     private:
         struct ExactRule
         {
@@ -57,9 +101,57 @@ namespace Proofpoint
             std::vector<PartialRule> partial_rules;
         };
 
+        struct PoptrieNode
+        {
+            // Children which are internal nodes
+            uint64_t vector;
+            // Children starting a run of leaves with the same set
+            uint64_t leafvec;
+            uint32_t base0;
+            uint32_t base1;
+        };
+
+        inline static const std::string LayoutStrings[] = {"trie", "dir-24-8", "poptrie"};
+
+        // Top bit of a DIR-24-8 tbl24 entry, the rest indexes a tbl8 block instead of a set
+        static constexpr uint32_t TBL8_FLAG = 0x80000000u;
+
+        // Addresses MatchBatch walks together
+        static constexpr std::size_t BATCH_LANES = 16;
+
     private:
         void Insert(ExactRule* rule);
 
+        struct Rule6
+        {
+            Subnet6 subnet;
+            int id;
+        };
+
+    private:
+        // Append the ids matching ip to matches
+        bool Lookup(uint32_t ip, std::vector<int>* matches) const;
+
+        bool Lookup(const Address6& ip, std::vector<int>* matches) const;
+
+        bool MatchTrie(uint32_t ip, std::vector<int>* matches) const;
+
+        bool MatchSet(uint32_t set, std::vector<int>* matches) const;
+
+        // Set of each of count addresses in the flat layouts
+        void ResolveDir24(const uint32_t* addresses, std::size_t count, uint32_t* sets) const;
+
+        void ResolvePoptrie(const uint32_t* addresses, std::size_t count, uint32_t* sets) const;
+
+        void BuildDir24(const std::vector<uint32_t>& starts, const std::vector<uint32_t>& interval_sets);
+
+        void BuildPoptrie(const std::vector<uint32_t>& starts, const std::vector<uint32_t>& interval_sets);
+
+        void BuildPoptrieNode(uint32_t node, uint32_t base, uint8_t offset,
+                              const std::vector<uint32_t>& starts, const std::vector<uint32_t>& interval_sets);
+
+        static std::size_t MemoryUsage(const TrieNode& node);
+
         static bool MatchesPartial(uint8_t octet, const PartialRule& partial);
 
         static uint8_t PartialMask(uint8_t bits);
@@ -72,6 +164,26 @@ namespace Proofpoint
         TrieNode root;
         std::deque<ExactRule> rules;
         int next_id{0};
+        Layout layout{Layout::TRIE};
+        bool frozen{false};
+
+        // Distinct sets of matching CIDR ids, set 0 is empty. Ids of set i are
+        // set_ids[set_offsets[i]] up to set_ids[set_offsets[i + 1]].
+        std::vector<uint32_t> set_offsets;
+        std::vector<int> set_ids;
+
+        std::vector<uint32_t> tbl24;
+        std::vector<uint32_t> tbl8;
+
+        std::vector<PoptrieNode> nodes;
+        std::vector<uint32_t> leaves;
+
+        // IPv6 CIDRs until frozen, then the start of every interval of the IPv6 space over
+        // which the matching CIDRs stay the same and the set each maps onto. A sorted range
+        // table is searched with one binary search whichever layout IPv4 uses.
+        std::vector<Rule6> rules6;
+        std::vector<Address6> starts6;
+        std::vector<uint32_t> sets6;
     };
 }
 
@@ -0,0 +1,178 @@
+/**
+ * This code was tested against C++20
+ *
+ * @author Ludvik Jerabek
+ * @package slanalyzer
+ * @version 1.0.0
+ * @license MIT
+ */
+#ifndef SLANALYZER_SUFFIXTRIE_H
+#define SLANALYZER_SUFFIXTRIE_H
+
+#include "IMatcher.h"
+#include "Utils.h"
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Proofpoint
+{
+	// Case-insensitive literal suffix search over every pattern of every list, replacing a
+	// Matcher(true, false, RE2::ANCHOR_START) per list run over reversed text.
+	//
+	// Patterns are stored reversed and folded in a single trie, each node keeps the postings
+	// of the patterns ending there. The text is walked backwards once from the root and every
+	// node passed with postings is a pattern the text ends with, whichever list it belongs to.
+	// Nodes are laid out breadth first so the children of a node are contiguous and sorted by
+	// label. Postings of a node keep the order they were added in.
+	//
+	// Reversed non-ASCII patterns aren't valid UTF-8 and were rejected by RE2, they are still
+	// reported as errors. A reversed non-ASCII character in the text never folded onto ASCII
+	// either, so the text only needs Utils::ascii_lower, which the caller does once per value.
+	template <typename T>
+	class SuffixTrie
+	{
+	public:
+		using Node = std::uint32_t;
+
+		void Add(const std::string& pattern, const T& index, PatternErrors<T>& pattern_errors);
+
+		// Builds the trie ahead of the first Match
+		void Compile()
+		{
+			std::call_once(built, [this] { Build(); });
+		}
+
+		// Appends the node of every pattern text ends with, shortest pattern first. text must be
+		// lowered with Utils::ascii_lower. Safe to call from several threads at once after Compile.
+		void Match(std::string_view text, std::vector<Node>& nodes) const;
+
+		// Postings of the patterns ending at node
+		[[nodiscard]] std::span<const T> Postings(Node node) const
+		{
+			return {postings.data() + nodes[node].postings, nodes[node].posting_count};
+		}
+
+		[[nodiscard]] std::size_t GetPatternCount() const { return pattern_count; }
+
+	private:
+		struct Entry
+		{
+			std::uint32_t first_child;
+			std::uint32_t child_count;
+			std::uint32_t postings;
+			std::uint32_t posting_count;
+		};
+
+		void Build();
+
+	private:
+		std::once_flag built;
+		// Reversed folded patterns waiting for the trie to be built
+		std::vector<std::pair<std::string, T>> pending;
+		std::size_t pattern_count = 0;
+
+		std::vector<Entry> nodes;
+		// Label of the edge leading into each node
+		std::vector<char> labels;
+		std::vector<T> postings;
+	};
+
+	template <typename T>
+	void SuffixTrie<T>::Add(const std::string& pattern, const T& index, PatternErrors<T>& pattern_errors)
+	{
+		if (!Utils::is_ascii(pattern))
+		{
+			pattern_errors.push_back({index, pattern, "invalid UTF-8"});
+			return;
+		}
+
+		std::string key(pattern.rbegin(), pattern.rend());
+		std::transform(key.begin(), key.end(), key.begin(), Utils::ascii_lower);
+		pending.emplace_back(std::move(key), index);
+		pattern_count++;
+	}
+
+	template <typename T>
+	void SuffixTrie<T>::Build()
+	{
+		// Keys sharing a prefix become contiguous, a key equal to the prefix comes first
+		std::stable_sort(pending.begin(), pending.end(), [](const auto& a, const auto& b)
+		{
+			return a.first < b.first;
+		});
+
+		// Range of sorted keys below each node and its depth, only needed while building
+		std::vector<std::pair<std::size_t, std::size_t>> ranges{{0, pending.size()}};
+		std::vector<std::size_t> depths{0};
+		nodes.push_back({0, 0, 0, 0});
+		labels.push_back('\0');
+		postings.reserve(pending.size());
+
+		for (std::size_t node = 0; node < nodes.size(); node++)
+		{
+			auto [lo, hi] = ranges[node];
+			const std::size_t depth = depths[node];
+
+			nodes[node].postings = static_cast<std::uint32_t>(postings.size());
+			for (; lo < hi && pending[lo].first.size() == depth; lo++)
+			{
+				postings.push_back(pending[lo].second);
+			}
+			nodes[node].posting_count = static_cast<std::uint32_t>(postings.size()) - nodes[node].postings;
+
+			nodes[node].first_child = static_cast<std::uint32_t>(nodes.size());
+			while (lo < hi)
+			{
+				const char label = pending[lo].first[depth];
+				std::size_t end = lo;
+				while (end < hi && pending[end].first[depth] == label)
+				{
+					end++;
+				}
+				nodes.push_back({0, 0, 0, 0});
+				labels.push_back(label);
+				ranges.emplace_back(lo, end);
+				depths.push_back(depth + 1);
+				lo = end;
+			}
+			nodes[node].child_count = static_cast<std::uint32_t>(nodes.size()) - nodes[node].first_child;
+		}
+
+		pending.clear();
+		pending.shrink_to_fit();
+	}
+
+	template <typename T>
+	void SuffixTrie<T>::Match(std::string_view text, std::vector<Node>& matches) const
+	{
+		Node node = 0;
+		if (nodes[node].posting_count)
+		{
+			matches.push_back(node);
+		}
+
+		for (std::size_t i = text.size(); i > 0; i--)
+		{
+			const char c = text[i - 1];
+			const auto first = labels.begin() + nodes[node].first_child;
+			const auto last = first + nodes[node].child_count;
+			const auto child = std::lower_bound(first, last, c);
+			if (child == last || *child != c)
+			{
+				return;
+			}
+
+			node = static_cast<Node>(child - labels.begin());
+			if (nodes[node].posting_count)
+			{
+				matches.push_back(node);
+			}
+		}
+	}
+}
+#endif //SLANALYZER_SUFFIXTRIE_H
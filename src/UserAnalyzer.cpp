@@ -8,125 +8,182 @@
  */
 
 #include "UserAnalyzer.h"
-#include "CsvParser.h"
+#include "MappedCsvParser.h"
 #include <chrono>
 #include "re2/re2.h"
 #include "Utils.h"
+#include "Memory.h"
+#include "HeaderFrom.h"
 
-void Proofpoint::UserAnalyzer::Load(const UserList& userlist, PatternErrors<UserMatch>& pattern_errors)
+// Calls count for the postings of user at each node, false when the user has none
+template <typename CountFn>
+static bool Count(const Proofpoint::SuffixTrie<Proofpoint::UserAnalyzer::UserMatch>& trie,
+                  const std::vector<Proofpoint::SuffixTrie<Proofpoint::UserAnalyzer::UserMatch>::Node>& nodes,
+                  std::size_t user_index, CountFn&& count)
+{
+	using UserMatch = Proofpoint::UserAnalyzer::UserMatch;
+	bool matched = false;
+	for (auto node : nodes)
+	{
+		auto postings = trie.Postings(node);
+		auto first = std::lower_bound(postings.begin(), postings.end(), user_index,
+		                              [](const UserMatch& m, std::size_t u) { return m.user_index < u; });
+		for (; first != postings.end() && first->user_index == user_index; ++first)
+		{
+			count(*first);
+			matched = true;
+		}
+	}
+	return matched;
+}
+
+void Proofpoint::UserAnalyzer::Load(const UserList& userlist, PatternErrors<UserMatch>& pattern_errors,
+                                    CompileStats& compile_stats, std::size_t threads)
 {
 	std::size_t count = 0;
+	std::string address;
 	addr_to_user.reserve(userlist.GetUserAddressCount());
 	for (auto user = userlist.begin(); user != userlist.end(); user++)
 	{
 		std::size_t index = std::distance(userlist.begin(), user);
 		//std::cout << "Load Primary: " << user->mail << " at " << index << std::endl;
-		addr_to_user.emplace(user->mail, index);
+		Utils::ascii_lower_copy(user->mail, address);
+		addr_to_user.emplace(address, index);
 		for (const auto& email : user->proxy_addresses)
 		{
 			//std::cout << "(" << user->mail << ") Load ProxyAddress: " << email << " at " << index << std::endl;
-			addr_to_user.emplace(email, index);
+			Utils::ascii_lower_copy(email, address);
+			addr_to_user.emplace(address, index);
 		}
-		if (!user->safe.empty())
+		for (std::size_t j = 0; j < user->safe.size(); j++)
 		{
-			safe_matcher.emplace(index, std::make_shared<Matcher<UserMatch>>(true, false, RE2::ANCHOR_START));
-			for (std::size_t j = 0; j < user->safe.size(); j++)
-			{
-				safe_matcher.at(index)->Add(Utils::reverse_copy(user->safe[j].pattern), {index, j}, pattern_errors);
-				//std::cout << "Added: (" << user->safe[j].pattern << ") " << user->givenName << "," << user->sn << " " << user->mail << "" << index << " --> " << j << std::endl;
-			}
+			safe_matcher.Add(user->safe[j].pattern, {index, j}, pattern_errors);
 		}
-		if (!user->block.empty())
+		for (std::size_t j = 0; j < user->block.size(); j++)
 		{
-			block_matcher.emplace(index, std::make_shared<Matcher<UserMatch>>(true, false, RE2::ANCHOR_START));
-			for (std::size_t j = 0; j < user->block.size(); j++)
-			{
-				block_matcher.at(index)->Add(Utils::reverse_copy(user->block[j].pattern), {index, j}, pattern_errors);
-				//std::cout << "Added: (" << user->block[j].pattern << ") " << user->givenName << "," << user->sn << " " << user->mail << "" << index << " --> " << j << std::endl;
-			}
+			block_matcher.Add(user->block[j].pattern, {index, j}, pattern_errors);
 		}
 		count++;
 	}
+
+	compile_stats = {
+		{"safelist", safe_matcher.GetPatternCount(), 0, 0},
+		{"blocklist", block_matcher.GetPatternCount(), 0, 0}
+	};
+
+	Utils::parallel_for(compile_stats.size(), threads, [&](std::size_t i)
+	{
+		auto start = std::chrono::steady_clock::now();
+		auto memory = Memory::thread_allocated();
+		(i == 0) ? safe_matcher.Compile() : block_matcher.Compile();
+		compile_stats[i].memory = Memory::thread_allocated() - memory;
+		compile_stats[i].seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	});
 }
 
-std::optional<std::size_t> Proofpoint::UserAnalyzer::Process(const std::string& ss_file, UserList& userlist,
-                                                             std::size_t& records_processed)
+std::optional<std::size_t> Proofpoint::UserAnalyzer::Process(const std::string& ss_file, const UserList& userlist,
+                                                             UserList::Counters& counters,
+                                                             std::size_t& records_processed,
+                                                             std::size_t& row_allocations) const
 {
 	records_processed = 0;
-	std::ifstream f(ss_file);
-	csv::CsvParser parser(f);
-	re2::StringPiece matches[2];
-	RE2 hfrom_addr_only(R"(<?\s*([a-zA-Z0-9.!#$%&’*+\/=?^_`{|}~-]+@[a-zA-Z0-9-]+(?:\.[a-zA-Z0-9-]+)*)\s*>?\s*(?:;|$))");
+	row_allocations = 0;
+	csv::MappedCsvParser parser(ss_file);
+	HeaderFrom hfrom_addr_only;
 	RE2 inbound_check(R"(\bdefault_inbound\b)");
-	csv::HeaderMap header_map;
+	// Slots of the required headers in a projected row
+	enum Column : std::size_t
+	{
+		POLICY_ROUTE,
+		HEADER_FROM,
+		SENDER,
+		RECIPIENTS
+	};
+
+	csv::Projection projection;
 	csv::HeaderList required_headers{"Policy_Route", "Header_From", "Sender", "Recipients"};
 	// Validate there are headers we are interested in...
-	auto header_index = parser.FindHeader(required_headers, header_map);
-	// std::cout << std::setw(35) << "Highest Index" << " " << std::setw(25) << header_index << std::endl;
-	// std::multimap is useful for CSVs where there may be duplicate headers.
-	// for (auto i = header_map.begin(); i!= header_map.end(); i++){
-	//	std::cout << std::setw(35) << i->first << " " << std::setw(25) << i->second  << " " << header_map.count(i->first) << std::endl;
-	// }
+	auto header_index = parser.FindHeader(required_headers, projection);
+
+	// Users without safe or block entries never match, there is nothing to extract
+	const bool match_any = safe_matcher.GetPatternCount() || block_matcher.GetPatternCount();
+
+	// Nodes of the patterns Sender and Header_From end with, walked once per row. These
+	// buffers keep their capacity so rows stop allocating once they have grown to fit.
+	std::vector<SuffixTrie<UserMatch>::Node> safe_sender, safe_hfrom, block_sender, block_hfrom;
+	std::vector<std::string_view> recipients;
+	// Fields lowered once per row, the tries and addresses are lowered alike
+	std::string sender, hfrom, recipient_list;
+
 	if (header_index)
 	{
-		for (auto& row : parser)
+		std::vector<std::string_view> row;
+		std::deque<std::string> unescaped;
+		while (parser.next_row(projection, row, unescaped))
 		{
-			//bool inbound = RE2::PartialMatch(row[header_map.find("Policy_Route")->second], inbound_check);
-			std::string hfrom = (hfrom_addr_only.Match(row[header_map.find("Header_From")->second], 0,
-			                                           row[header_map.find("Header_From")->second].length(),
-			                                           RE2::UNANCHORED, matches, 2))
-				                    ? Utils::cvt_std_string(matches[1])
-				                    : row[header_map.find("Header_From")->second];
-			Utils::reverse(hfrom);
-			std::string sender = Utils::reverse_copy(row[header_map.find("Sender")->second]);
-
-			for (auto recipient : Utils::split(row[header_map.find("Recipients")->second], ','))
+			// Short rows (blank lines, truncated exports) don't carry the fields we need
+			if (row.empty())
+				continue;
+
+			records_processed++;
+
+			if (!match_any)
+				continue;
+
+			const std::uint64_t allocations = Memory::thread_allocations();
+
+			//bool inbound = RE2::PartialMatch(row[POLICY_ROUTE], inbound_check);
+			bool walked = false;
+
+			Utils::ascii_lower_copy(row[RECIPIENTS], recipient_list);
+			Utils::split(recipient_list, ',', recipients);
+			for (auto recipient : recipients)
 			{
-				auto user = addr_to_user.find(std::string(recipient));
-				if (user != addr_to_user.end())
+				auto user = addr_to_user.find(recipient);
+				if (user == addr_to_user.end())
+					continue;
+
+				if (!walked)
 				{
-					auto smatcher = safe_matcher.find(user->second);
-					if (smatcher != safe_matcher.end())
-					{
-						std::vector<UserMatch> user_matches;
-						bool matched = smatcher->second->Match(sender, user_matches);
-						for (auto m : user_matches)
-						{
-							//std::cout << "Sender Safe Matched: " << m.list_index << "-->" << m.user_index << std::endl;
-							userlist.entries[m.user_index].safe[m.list_index].sender_count++;
-						}
-						matched |= smatcher->second->Match(hfrom, user_matches);
-						for (auto m : user_matches)
-						{
-							//std::cout << "Header Safe Matched: " << m.list_index << "-->" << m.user_index << std::endl;
-							userlist.entries[m.user_index].safe[m.list_index].hfrom_count++;
-						}
-						if (matched)
-							userlist.entries[user->second].safe_count++;
-					}
-
-					auto bmatcher = block_matcher.find(user->second);
-					if (bmatcher != block_matcher.end())
-					{
-						std::vector<UserMatch> user_matches;
-						bool matched = bmatcher->second->Match(sender, user_matches);
-						for (auto m : user_matches)
-						{
-							//std::cout << "Sender Block Matched: " << m.list_index << "-->" << m.user_index << std::endl;
-							userlist.entries[m.user_index].block[m.list_index].sender_count++;
-						}
-						matched |= bmatcher->second->Match(hfrom, user_matches);
-						for (auto m : user_matches)
-						{
-							//std::cout << "Header Block Matched: " << m.list_index << "-->" << m.user_index << std::endl;
-							userlist.entries[m.user_index].block[m.list_index].hfrom_count++;
-						}
-						if (matched)
-							userlist.entries[user->second].block_count++;
-					}
+					Utils::ascii_lower_copy(row[SENDER], sender);
+					Utils::ascii_lower_copy(hfrom_addr_only.Extract(row[HEADER_FROM]), hfrom);
+					safe_sender.clear();
+					safe_hfrom.clear();
+					block_sender.clear();
+					block_hfrom.clear();
+					safe_matcher.Match(sender, safe_sender);
+					safe_matcher.Match(hfrom, safe_hfrom);
+					block_matcher.Match(sender, block_sender);
+					block_matcher.Match(hfrom, block_hfrom);
+					walked = true;
 				}
+
+				const Proofpoint::UserList::Entry& entry = userlist.entries[user->second];
+
+				bool matched = Count(safe_matcher, safe_sender, user->second, [&](const UserMatch& m)
+				{
+					counters.safe[entry.safe_offset + m.list_index].sender_count++;
+				});
+				matched |= Count(safe_matcher, safe_hfrom, user->second, [&](const UserMatch& m)
+				{
+					counters.safe[entry.safe_offset + m.list_index].hfrom_count++;
+				});
+				if (matched)
+					counters.safe_count[user->second]++;
+
+				matched = Count(block_matcher, block_sender, user->second, [&](const UserMatch& m)
+				{
+					counters.block[entry.block_offset + m.list_index].sender_count++;
+				});
+				matched |= Count(block_matcher, block_hfrom, user->second, [&](const UserMatch& m)
+				{
+					counters.block[entry.block_offset + m.list_index].hfrom_count++;
+				});
+				if (matched)
+					counters.block_count[user->second]++;
 			}
-			records_processed++;
+
+			row_allocations += Memory::thread_allocations() - allocations;
 		}
 	}
 	return header_index;
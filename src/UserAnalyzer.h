@@ -10,38 +10,30 @@
 #define SLANALYZER_USERANALYZER_H
 
 #include "UserList.h"
-#include "Matcher.h"
+#include "SuffixTrie.h"
+#include "Utils.h"
 #include <memory>
-#include <cstring>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
 #include <map>
+#include <optional>
+#include <unordered_map>
 
 namespace Proofpoint
 {
 	class UserAnalyzer
 	{
 	public:
-		struct case_insensitive_unordered_map
+		// Transparent so recipients can be looked up straight from the lowered row
+		struct string_hash
 		{
-			struct comp
-			{
-				bool operator()(const std::string& lhs, const std::string& rhs) const
-				{
-					return strcasecmp(lhs.c_str(), rhs.c_str()) == 0;
-				}
-			};
+			using is_transparent = void;
 
-			struct hash
+			std::size_t operator()(std::string_view str) const
 			{
-				std::size_t operator()(std::string str) const
-				{
-					for (std::size_t index = 0; index < str.size(); ++index)
-					{
-						auto ch = static_cast<unsigned char>(str[index]);
-						str[index] = static_cast<unsigned char>(std::tolower(ch));
-					}
-					return std::hash<std::string>{}(str);
-				}
-			};
+				return std::hash<std::string_view>{}(str);
+			}
 		};
 
 		struct UserMatch
@@ -55,15 +47,21 @@ namespace Proofpoint
 	public:
 		UserAnalyzer() = default;
 		~UserAnalyzer() = default;
-		void Load(const UserList& safelist, PatternErrors<UserMatch>& pattern_errors);
-		std::optional<std::size_t> Process(const std::string& ss_file, UserList& safelist,
-		                                   std::size_t& records_processed);
+		// Adds every safe and block entry and builds both tries on up to threads threads
+		void Load(const UserList& safelist, PatternErrors<UserMatch>& pattern_errors, CompileStats& compile_stats,
+		          std::size_t threads = 1);
+		// The tries are read only after Load, any number of threads may process files at once.
+		// row_allocations counts the allocations evaluating rows made, see GlobalAnalyzer.
+		std::optional<std::size_t> Process(const std::string& ss_file, const UserList& userlist,
+		                                   UserList::Counters& counters, std::size_t& records_processed,
+		                                   std::size_t& row_allocations) const;
 
 	private:
-		std::unordered_map<std::string, UserIndex, case_insensitive_unordered_map::hash,
-		                   case_insensitive_unordered_map::comp> addr_to_user;
-		std::unordered_map<UserIndex, std::shared_ptr<Matcher<UserMatch>>> safe_matcher;
-		std::unordered_map<UserIndex, std::shared_ptr<Matcher<UserMatch>>> block_matcher;
+		// Addresses lowered with Utils::ascii_lower, as the row fields are once per row
+		std::unordered_map<std::string, UserIndex, string_hash, std::equal_to<>> addr_to_user;
+		// Safe and block patterns of every user, postings are ordered by user
+		SuffixTrie<UserMatch> safe_matcher;
+		SuffixTrie<UserMatch> block_matcher;
 	};
 }
 #endif //SLANALYZER_USERANALYZER_H
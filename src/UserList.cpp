@@ -8,7 +8,7 @@
  */
 
 #include "UserList.h"
-#include "CsvParser.h"
+#include "MappedCsvParser.h"
 #include <iostream>
 #include <numeric>
 #include "Utils.h"
@@ -21,8 +21,7 @@ void Proofpoint::UserList::Load(const std::string& user_file, [[maybe_unused]] U
 {
 	user_address_count = 0;
 	std::size_t line_number = 0;
-	std::ifstream f(user_file);
-	csv::CsvParser parser(f);
+	csv::MappedCsvParser parser(user_file);
 	csv::HeaderMap header_map;
 	csv::HeaderList required_headers{
 		"mailLocalAddress",
@@ -42,10 +41,13 @@ void Proofpoint::UserList::Load(const std::string& user_file, [[maybe_unused]] U
 			size_t cols = row.size();
 
 			// Skip empty lines
-			if (cols == 1 && Utils::trim_copy(row.at(0)).empty())
+			if (cols == 1 && Utils::trim_copy(std::string(row[0])).empty())
+				continue;
+
+			// Rows missing the required columns can't be loaded
+			if (cols <= *header_index)
 				continue;
 
-			// Should add some logic to make sure that the column numbers exist
 			entries.emplace_back();
 			entries.back().line_number = line_number;
 			entries.back().givenName = row[header_map.find("givenName")->second];
@@ -53,6 +55,8 @@ void Proofpoint::UserList::Load(const std::string& user_file, [[maybe_unused]] U
 			entries.back().mail = row[header_map.find("mail")->second];
 			entries.back().safe_count = 0;
 			entries.back().block_count = 0;
+			entries.back().safe_offset = safe_list_count;
+			entries.back().block_offset = block_list_count;
 			user_address_count++;
 			for (auto proxy_address : Utils::split(row[header_map.find("mailLocalAddress")->second], ';'))
 			{
@@ -181,3 +185,33 @@ std::size_t Proofpoint::UserList::GetBlockCount() const
 		return a + b.block_count;
 	});
 }
+
+Proofpoint::UserList::Counters Proofpoint::UserList::MakeCounters() const
+{
+	return {
+		std::vector<std::size_t>(entries.size(), 0),
+		std::vector<std::size_t>(entries.size(), 0),
+		std::vector<Counter>(safe_list_count, Counter{0, 0}),
+		std::vector<Counter>(block_list_count, Counter{0, 0})
+	};
+}
+
+void Proofpoint::UserList::Merge(const Counters& counters)
+{
+	for (std::size_t i = 0; i < entries.size(); i++)
+	{
+		auto& user = entries[i];
+		user.safe_count += counters.safe_count[i];
+		user.block_count += counters.block_count[i];
+		for (std::size_t j = 0; j < user.safe.size(); j++)
+		{
+			user.safe[j].hfrom_count += counters.safe[user.safe_offset + j].hfrom_count;
+			user.safe[j].sender_count += counters.safe[user.safe_offset + j].sender_count;
+		}
+		for (std::size_t j = 0; j < user.block.size(); j++)
+		{
+			user.block[j].hfrom_count += counters.block[user.block_offset + j].hfrom_count;
+			user.block[j].sender_count += counters.block[user.block_offset + j].sender_count;
+		}
+	}
+}
@@ -43,9 +43,27 @@ namespace Proofpoint
 			std::vector<ListItem> block;
 			std::size_t safe_count;
 			std::size_t block_count;
+			// Position of the first safe / block item in the flattened Counters
+			std::size_t safe_offset;
+			std::size_t block_offset;
 		};
 
 		using Entries = std::vector<Entry>;
+
+		// Match counts kept apart from the entries so each worker can count on its own
+		struct Counter
+		{
+			std::size_t hfrom_count;
+			std::size_t sender_count;
+		};
+
+		struct Counters
+		{
+			std::vector<std::size_t> safe_count;
+			std::vector<std::size_t> block_count;
+			std::vector<Counter> safe;
+			std::vector<Counter> block;
+		};
 		using iterator = Entries::iterator;
 		using const_iterator = Entries::const_iterator;
 
@@ -67,6 +85,8 @@ namespace Proofpoint
 		[[nodiscard]] inline std::size_t GetUserAddressCount() const { return user_address_count; }
 		[[nodiscard]] inline std::size_t GetSafeListCount() const { return safe_list_count; }
 		[[nodiscard]] inline std::size_t GetBlockListCount() const { return block_list_count; }
+		[[nodiscard]] Counters MakeCounters() const;
+		void Merge(const Counters& counters);
 		[[nodiscard]] std::size_t GetSafeCount() const;
 		[[nodiscard]] std::size_t GetBlockCount() const;
 		iterator begin() { return entries.begin(); }
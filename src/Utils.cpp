@@ -12,7 +12,13 @@
 std::vector<std::string_view> Proofpoint::Utils::split(std::string_view str, char d)
 {
 	std::vector<std::string_view> res;
-	res.reserve(str.length() / 2);
+	split(str, d, res);
+	return res;
+}
+
+void Proofpoint::Utils::split(std::string_view str, char d, std::vector<std::string_view>& res)
+{
+	res.clear();
 	const char* ptr = str.data();
 	size_t size = 0;
 	for (const char c : str)
@@ -28,7 +34,6 @@ std::vector<std::string_view> Proofpoint::Utils::split(std::string_view str, cha
 	}
 	if (size)
 		res.emplace_back(ptr, size);
-	return res;
 }
 
 void Proofpoint::Utils::reverse(std::string& str)
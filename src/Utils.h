@@ -9,10 +9,17 @@
 #ifndef SLANALYZER_UTILS_H
 #define SLANALYZER_UTILS_H
 
+#include <algorithm>
+#include <atomic>
 #include <string>
+#include <thread>
 #include <vector>
 #include <string_view>
 
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 namespace Proofpoint::Utils
 {
     void reverse(std::string& str);
@@ -24,12 +31,105 @@ namespace Proofpoint::Utils
     std::string rtrim_copy(std::string s);
     std::string trim_copy(std::string s);
     std::vector<std::string_view> split(std::string_view str, char d);
+    // Same as split, out is cleared and its capacity reused so repeated calls don't allocate
+    void split(std::string_view str, char d, std::vector<std::string_view>& out);
+
+    // Calls fn(i) for every i below count from up to threads threads, each i exactly once
+    template <typename Fn>
+    void parallel_for(std::size_t count, std::size_t threads, Fn&& fn)
+    {
+        threads = std::clamp<std::size_t>(threads, 1, std::max<std::size_t>(count, 1));
+        if (threads == 1)
+        {
+            for (std::size_t i = 0; i < count; i++)
+                fn(i);
+            return;
+        }
+
+        std::atomic<std::size_t> next = 0;
+        std::vector<std::jthread> pool;
+        pool.reserve(threads);
+        for (std::size_t t = 0; t < threads; t++)
+        {
+            pool.emplace_back([&]
+            {
+                for (std::size_t i = next++; i < count; i = next++)
+                    fn(i);
+            });
+        }
+    }
 
     template <typename T>
     inline std::string cvt_std_string(const T& value)
     {
         return std::string(value.data(), value.size());
     }
+
+    inline char ascii_lower(char c)
+    {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+    }
+
+    inline bool is_ascii(std::string_view str)
+    {
+        for (const char c : str)
+        {
+            if (static_cast<unsigned char>(c) & 0x80)
+                return false;
+        }
+        return true;
+    }
+
+    // Copies str into out with its ASCII letters lowered, 16 bytes at a time where SSE2 is
+    // available, and tells whether str is ASCII. Other bytes are copied as they are.
+    inline bool ascii_lower_copy(std::string_view str, std::string& out)
+    {
+        out.resize(str.size());
+        char* lower = out.data();
+        std::size_t i = 0;
+        unsigned high = 0;
+#if defined(__SSE2__)
+        const __m128i before_a = _mm_set1_epi8('A' - 1);
+        const __m128i after_z = _mm_set1_epi8('Z' + 1);
+        const __m128i case_bit = _mm_set1_epi8(0x20);
+        for (; i + 16 <= str.size(); i += 16)
+        {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str.data() + i));
+            high |= static_cast<unsigned>(_mm_movemask_epi8(v));
+            // The compares are signed, bytes from 0x80 on are negative and left alone
+            const __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, before_a), _mm_cmplt_epi8(v, after_z));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(lower + i), _mm_or_si128(v, _mm_and_si128(upper, case_bit)));
+        }
+#endif
+        for (; i < str.size(); i++)
+        {
+            high |= static_cast<unsigned char>(str[i]) & 0x80;
+            lower[i] = ascii_lower(str[i]);
+        }
+        return !high;
+    }
+
+    // Case folds the character at str[i] the way RE2 does against ASCII patterns and moves
+    // past it. Unicode folding maps exactly two non-ASCII characters onto ASCII letters,
+    // U+212A KELVIN SIGN onto 'k' and U+017F LATIN SMALL LETTER LONG S onto 's', any other
+    // non-ASCII byte returns -1 as no ASCII pattern character can match it.
+    inline int ascii_fold_next(std::string_view str, std::size_t& i)
+    {
+        const char c = str[i++];
+        if (!(static_cast<unsigned char>(c) & 0x80))
+            return ascii_lower(c);
+        if (c == '\xE2' && str.substr(i, 2) == "\x84\xAA")
+        {
+            i += 2;
+            return 'k';
+        }
+        if (c == '\xC5' && i < str.size() && str[i] == '\xBF')
+        {
+            i += 1;
+            return 's';
+        }
+        return -1;
+    }
 }
 
 #endif //SLANALYZER_UTILS_H
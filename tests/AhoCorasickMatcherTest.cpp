@@ -0,0 +1,119 @@
+/**
+ * This code was tested against C++20
+ *
+ * @author Ludvik Jerabek
+ * @package slanalyzer
+ * @version 1.0.0
+ * @license MIT
+ */
+#include "MatcherCheck.h"
+#include "AhoCorasickMatcher.h"
+#include "Matcher.h"
+
+using namespace Proofpoint;
+using Proofpoint::Test::Check;
+
+// The first character boundary of text at or after offset
+static std::size_t Boundary(const std::string& text, std::size_t offset)
+{
+	while (offset < text.size() && (static_cast<unsigned char>(text[offset]) & 0xC0) == 0x80)
+		offset++;
+	return offset;
+}
+
+// Text of ASCII pieces only, every pattern made of them goes into the automaton
+static std::string AsciiText(std::mt19937& random, std::size_t max_pieces)
+{
+	std::string text;
+	for (std::size_t n = random() % (max_pieces + 1); n; n--)
+	{
+		std::string_view piece;
+		do
+		{
+			piece = Test::PIECES[random() % Test::PIECES.size()];
+		} while (!Utils::is_ascii(piece));
+		text += piece;
+	}
+	return text;
+}
+
+// Compares a random list of count substring entries with pieces pieces at most, ASCII ones
+// when ascii is set
+static void CompareList(std::mt19937& random, std::size_t count, std::size_t pieces, std::size_t value_count,
+                        bool ascii = false)
+{
+	// The match entries went through an unanchored case-insensitive literal RE2 set
+	Matcher<std::size_t> reference(true, false, RE2::UNANCHORED);
+	AhoCorasickMatcher<std::size_t> automaton;
+	PatternErrors<std::size_t> errors;
+
+	// Some patterns start inside a prefix of the one before and go on differently, a value
+	// running through that prefix and on into the pattern has to leave the deep state the
+	// prefix ends in by its failure link to find it
+	std::vector<std::string> patterns, values;
+	for (std::size_t i = 0; i < count; i++)
+	{
+		std::string pattern = ascii ? AsciiText(random, pieces) : Test::RandomText(random, pieces);
+		if (i && random() % 8 == 0)
+		{
+			pattern = patterns[random() % i];
+		}
+		else if (i && random() % 3 == 0 && !patterns[i - 1].empty())
+		{
+			const std::string& other = patterns[i - 1];
+			const std::size_t end = Boundary(other, 1 + random() % other.size());
+			const std::size_t start = Boundary(other, random() % end);
+			pattern = other.substr(start, end - start) + pattern.substr(0, Boundary(pattern, pattern.size() / 2));
+			values.push_back(other.substr(0, start) + pattern);
+		}
+		patterns.push_back(pattern);
+		reference.Add(patterns.back(), i, errors);
+		automaton.Add(patterns.back(), i, errors);
+	}
+	reference.Compile(errors);
+	automaton.Compile(errors);
+	Check(errors.empty(), "Literal patterns reported errors");
+
+	// A prefix of one pattern ahead of another leaves the automaton deep in the trie when the
+	// second one starts
+	for (std::size_t i = 0; i < value_count; i++)
+	{
+		const std::string& first = patterns[random() % patterns.size()];
+		const std::string& second = patterns[random() % patterns.size()];
+		switch (random() % 3)
+		{
+		case 0: values.push_back(Test::Variant(random, first, true));
+			break;
+		case 1: values.push_back(first.substr(0, Boundary(first, random() % (first.size() + 1))) +
+		                         Test::Variant(random, second, false));
+			break;
+		default: values.push_back(Test::RandomText(random, 12));
+		}
+	}
+	Test::CompareMatchers("AhoCorasickMatcher", reference, automaton, values);
+}
+
+int main()
+{
+	// Nothing to find before Compile, nor in an empty list
+	{
+		AhoCorasickMatcher<std::size_t> automaton;
+		PatternErrors<std::size_t> errors;
+		MatchScratch<std::size_t> scratch;
+		std::vector<std::size_t> found;
+		Check(!automaton.Match("a", found, scratch) && found.empty(), "AhoCorasickMatcher matched an empty list");
+		automaton.Add("a", 0, errors);
+		Check(!automaton.Match("a", found, scratch) && found.empty(), "AhoCorasickMatcher matched before Compile");
+	}
+
+	std::mt19937 random(7);
+	for (int round = 0; round < 50; round++)
+	{
+		CompareList(random, 1 + random() % 100, 5, 500);
+	}
+
+	// Enough states that the deeper ones no longer get dense rows
+	CompareList(random, 10000, 30, 5000, true);
+
+	return Test::Result("AhoCorasickMatcherTest");
+}
@@ -0,0 +1,40 @@
+/**
+ * This code was tested against C++20
+ *
+ * @author Ludvik Jerabek
+ * @package slanalyzer
+ * @version 1.0.0
+ * @license MIT
+ */
+#ifndef SLANALYZER_CHECK_H
+#define SLANALYZER_CHECK_H
+
+#include <iostream>
+#include <string>
+
+namespace Proofpoint::Test
+{
+	// Checks of one test program, the first few failures are printed with what was compared
+	// and any failure fails the program
+	inline std::size_t failures = 0;
+	inline std::size_t checks = 0;
+
+	inline bool Check(bool ok, const std::string& what)
+	{
+		constexpr std::size_t MAX_REPORTED = 20;
+		checks++;
+		if (!ok && failures++ < MAX_REPORTED)
+		{
+			std::cerr << "FAILED: " << what << std::endl;
+		}
+		return ok;
+	}
+
+	// Exit status of the test program
+	inline int Result(const std::string& name)
+	{
+		std::cout << name << ": " << checks - failures << " of " << checks << " checks passed" << std::endl;
+		return failures ? 1 : 0;
+	}
+}
+#endif //SLANALYZER_CHECK_H
@@ -0,0 +1,146 @@
+/**
+ * This code was tested against C++20
+ *
+ * @author Ludvik Jerabek
+ * @package slanalyzer
+ * @version 1.0.0
+ * @license MIT
+ */
+#include "MatcherCheck.h"
+#include "DomainPartitionMatcher.h"
+#include "Matcher.h"
+
+using namespace Proofpoint;
+using Proofpoint::Test::Check;
+
+// A random regex entry and a text it matches
+struct Regex
+{
+	std::string pattern;
+	std::string sample;
+};
+
+static std::string RandomDomain(std::mt19937& random)
+{
+	static const char* const labels[] = {"mail", "smtp", "vendor", "example", "corp", "a1", "k"};
+	static const char* const tlds[] = {"com", "org", "net", "co"};
+	std::string domain;
+	for (std::size_t n = random() % 3; n; n--)
+	{
+		domain += labels[random() % std::size(labels)];
+		domain += '.';
+	}
+	return domain + tlds[random() % std::size(tlds)];
+}
+
+// Address regexes of the forms vendor entries take, and those RequiredSuffix has to skip
+// over or give up on
+static Regex RandomRegex(std::mt19937& random)
+{
+	const std::string domain = RandomDomain(random);
+	const std::string quoted = RE2::QuoteMeta(domain);
+	const std::string user = Test::RandomText(random, 3) + "b";
+	switch (random() % 12)
+	{
+	case 0: return {"^.*@" + quoted + "$", user + "@" + domain};
+	case 1: return {"^[a-z0-9._-]+@" + quoted + "$", "bob@" + domain};
+	case 2: return {"@(mail|smtp)\\." + quoted + "$", user + "@smtp." + domain};
+	case 3: return {"(?P<m>mail|smtp)\\." + quoted + "$", user + "@mail." + domain};
+	case 4: return {"@[[:alpha:]]+\\." + quoted + "$", user + "@relay." + domain};
+	case 5: return {"\\x{40}" + quoted + "$", user + "@" + domain};
+	// Matches without the domain, nothing may be required of the value's end
+	case 6: return {"^" + RE2::QuoteMeta(user) + "@|\\." + quoted + "$", user + "@elsewhere"};
+	// $ matches ahead of a newline too
+	case 7: return {"(?m)@" + quoted + "$", user + "@" + domain + "\nx"};
+	// The last character may be repeated or left out
+	case 8:
+	{
+		static const char* const quantifiers[] = {"?", "*", "+", "{2}"};
+		const char* quantifier = quantifiers[random() % std::size(quantifiers)];
+		std::string sample = user + "@" + domain;
+		if (quantifier[0] == '?' || quantifier[0] == '*')
+			sample.pop_back();
+		else
+			sample.push_back(domain.back());
+		return {"@" + quoted + quantifier + "$", sample};
+	}
+	// Without an end, these stay in the residual engine
+	case 9: return {"@" + quoted, user + "@" + domain + ".extra"};
+	case 10: return {"@" + quoted + "\\$", user + "@" + domain + "$"};
+	default: return {Test::RandomText(random, 3) + "@" + quoted + "$", user + "@" + domain};
+	}
+}
+
+// Compares count random regexes, every value through the partitions and the residual engine
+static std::size_t CompareList(std::mt19937& random, std::size_t count, std::size_t value_count)
+{
+	// The regex entries of address fields went through an unanchored case-insensitive RE2 set
+	Matcher<std::size_t> reference(false, false, RE2::UNANCHORED);
+	DomainPartitionMatcher<std::size_t> partitioned(true);
+	PatternErrors<std::size_t> errors;
+
+	std::vector<Regex> regexes;
+	for (std::size_t i = 0; i < count; i++)
+	{
+		regexes.push_back(RandomRegex(random));
+		reference.Add(regexes.back().pattern, i, errors);
+		partitioned.Add(regexes.back().pattern, i, errors);
+	}
+	reference.Compile(errors);
+	partitioned.Compile(errors);
+	Check(errors.empty(), "Regex patterns reported errors");
+	Check(partitioned.GetPatternCount() == count, "DomainPartitionMatcher lost patterns");
+
+	std::vector<std::string> values;
+	for (std::size_t i = 0; i < value_count; i++)
+	{
+		switch (random() % 3)
+		{
+		case 0: values.push_back(Test::Variant(random, regexes[random() % regexes.size()].sample, true));
+			break;
+		// Another domain under the same parents, or a parent of the one the regex ends with
+		case 1: values.push_back(Test::RandomText(random, 2) + "@" + RandomDomain(random));
+			break;
+		default: values.push_back(regexes[random() % regexes.size()].sample + (random() % 2 ? "\n" : "m"));
+		}
+	}
+	Test::CompareMatchers("DomainPartitionMatcher", reference, partitioned, values);
+
+	RegexStat stat;
+	partitioned.GetRegexStat(stat);
+	return stat.partitions;
+}
+
+int main()
+{
+	// The keys regexes are partitioned by, empty where the end of a match isn't a literal
+	const std::pair<std::string, std::string> keys[] = {
+		{"^.*@mail\\.vendor\\.com$", "@mail.vendor.com"},
+		{"@(mail|smtp)\\.vendor\\.com$", ".vendor.com"},
+		{"(?P<m>mail|smtp)\\.vendor\\.com$", ".vendor.com"},
+		{"@[[:alpha:]]+\\.vendor\\.com$", ".vendor.com"},
+		{"\\x{40}vendor\\.com$", ".com"},
+		{"^bob@|\\.vendor\\.com$", ""},
+		{"(?m)@vendor\\.com$", ""},
+		{"@vendor\\.com+$", ""},
+		{"@vendor\\.com{2}$", ""},
+		{"@vendor\\.com", ""},
+		{"@vendor\\.com\\$", ""}
+	};
+	for (const auto& [pattern, key] : keys)
+	{
+		Check(DomainPartitionMatcher<std::size_t>::Key(pattern) == key, "Wrong partition key for [" + pattern + "]");
+	}
+
+	// Below 256 regexes nothing is partitioned, above the domains split them
+	std::mt19937 random(24);
+	std::size_t partitions = 0;
+	for (int round = 0; round < 8; round++)
+	{
+		partitions += CompareList(random, 256 + random() % 600, 2000);
+	}
+	Check(partitions > 0, "No regex was partitioned by its domain");
+	Check(CompareList(random, 100, 500) == 0, "Regexes below the threshold were partitioned");
+
+	return Test::Result("DomainPartitionMatcherTest");
+}
@@ -0,0 +1,120 @@
+/**
+ * This code was tested against C++20
+ *
+ * @author Ludvik Jerabek
+ * @package slanalyzer
+ * @version 1.0.0
+ * @license MIT
+ */
+#include "MatcherCheck.h"
+#include "FilteredMatcher.h"
+#include "Matcher.h"
+
+using namespace Proofpoint;
+using Proofpoint::Test::Check;
+
+// A random regex and a text it matches
+struct Regex
+{
+	std::string pattern;
+	std::string sample;
+};
+
+// Literal runs long enough for atoms, joined by alternations, classes and wildcards which
+// split them
+static Regex RandomRegex(std::mt19937& random)
+{
+	Regex regex;
+	if (random() % 4 == 0)
+		regex.pattern = "^";
+	for (std::size_t n = 1 + random() % 4; n; n--)
+	{
+		switch (random() % 6)
+		{
+		case 0:
+		{
+			std::string first = Test::RandomText(random, 5), second = Test::RandomText(random, 5);
+			regex.pattern += "(?:" + RE2::QuoteMeta(first) + "|" + RE2::QuoteMeta(second) + ")";
+			regex.sample += random() % 2 ? first : second;
+			break;
+		}
+		case 1:
+			regex.pattern += "[ab0-]";
+			regex.sample += "ab0-"[random() % 4];
+			break;
+		case 2:
+			regex.pattern += ".*";
+			regex.sample += Test::RandomText(random, 3);
+			break;
+		case 3:
+			regex.pattern += ".";
+			regex.sample += Test::PIECES[random() % Test::PIECES.size()];
+			break;
+		default:
+		{
+			std::string literal = Test::RandomText(random, 8);
+			regex.pattern += RE2::QuoteMeta(literal);
+			regex.sample += literal;
+		}
+		}
+	}
+	if (random() % 4 == 0)
+		regex.pattern += "$";
+	return regex;
+}
+
+// Compares count random regexes, enough of them are filtered by their atoms
+static void CompareList(std::mt19937& random, std::size_t count, std::size_t value_count)
+{
+	// The regex entries went through an unanchored case-insensitive RE2 set
+	Matcher<std::size_t> reference(false, false, RE2::UNANCHORED);
+	FilteredMatcher<std::size_t> filtered;
+	PatternErrors<std::size_t> errors;
+
+	std::vector<Regex> regexes;
+	for (std::size_t i = 0; i < count; i++)
+	{
+		// Repeats add several entries for one regex
+		regexes.push_back(i && random() % 8 == 0 ? regexes[random() % i] : RandomRegex(random));
+		reference.Add(regexes.back().pattern, i, errors);
+		filtered.Add(regexes.back().pattern, i, errors);
+	}
+	reference.Compile(errors);
+	filtered.Compile(errors);
+	Check(errors.empty(), "Regex patterns reported errors");
+
+	std::vector<std::string> values;
+	for (std::size_t i = 0; i < value_count; i++)
+	{
+		values.push_back(random() % 2 ? Test::Variant(random, regexes[random() % regexes.size()].sample, true)
+		                              : Test::RandomText(random, 12));
+	}
+	Test::CompareMatchers("FilteredMatcher", reference, filtered, values);
+}
+
+int main()
+{
+	// Nothing to find before Compile, nor in an empty list
+	{
+		FilteredMatcher<std::size_t> filtered;
+		PatternErrors<std::size_t> errors;
+		MatchScratch<std::size_t> scratch;
+		std::vector<std::size_t> found;
+		Check(!filtered.Match("a", found, scratch) && found.empty(), "FilteredMatcher matched an empty list");
+		filtered.Add("a", 0, errors);
+		Check(!filtered.Match("a", found, scratch) && found.empty(), "FilteredMatcher matched before Compile");
+	}
+
+	// Small lists stay in the RE2 set, larger ones go through the atoms
+	std::mt19937 random(21);
+	for (int round = 0; round < 20; round++)
+	{
+		CompareList(random, 1 + random() % 100, 500);
+	}
+	for (int round = 0; round < 4; round++)
+	{
+		CompareList(random, 600 + random() % 1000, 2000);
+	}
+
+	return Test::Result("FilteredMatcherTest");
+}
@@ -0,0 +1,191 @@
+/**
+ * This code was tested against C++20
+ *
+ * @author Ludvik Jerabek
+ * @package slanalyzer
+ * @version 1.0.0
+ * @license MIT
+ */
+#include "MatcherCheck.h"
+#include "GlobalStringMatcher.h"
+#include "Matcher.h"
+#include "RegexLiteral.h"
+
+using namespace Proofpoint;
+using Proofpoint::Test::Check;
+
+// A random regex entry and a text it matches
+struct Regex
+{
+	std::string pattern;
+	std::string sample;
+};
+
+// Literal text with escaped punctuation, mostly left to a literal engine. Anchors, .* at
+// either end, wildcards, classes and escapes which aren't characters keep some in RE2.
+static Regex RandomRegex(std::mt19937& random)
+{
+	Regex regex;
+	switch (random() % 4)
+	{
+	case 0: regex.pattern = "^";
+		break;
+	case 1: regex.pattern = ".*";
+		regex.sample = Test::RandomText(random, 2);
+		break;
+	default: break;
+	}
+
+	for (std::size_t n = 1 + random() % 8; n; n--)
+	{
+		const std::string& piece = Test::PIECES[random() % Test::PIECES.size()];
+		switch (random() % 16)
+		{
+		case 0: regex.pattern += "[ab]";
+			regex.sample += "ab"[random() % 2];
+			continue;
+		case 1: regex.pattern += "\\d";
+			regex.sample += static_cast<char>('0' + random() % 10);
+			continue;
+		case 2: regex.pattern += "(?:" + piece + "|x)";
+			regex.sample += piece;
+			continue;
+		case 3: regex.pattern += "\\$";
+			regex.sample += "$";
+			continue;
+		case 4: regex.pattern += "\\\\";
+			regex.sample += "\\";
+			continue;
+		default: break;
+		}
+
+		if (piece == ".")
+			regex.pattern += random() % 4 ? "\\." : ".";
+		else if (Utils::is_ascii(piece) && !std::isalnum(static_cast<unsigned char>(piece[0])) && random() % 2)
+			regex.pattern += "\\" + piece;
+		else
+			regex.pattern += piece;
+		regex.sample += piece;
+	}
+
+	switch (random() % 4)
+	{
+	case 0: regex.pattern += "$";
+		break;
+	case 1: regex.pattern += ".*";
+		regex.sample += Test::RandomText(random, 2);
+		break;
+	default: break;
+	}
+	return regex;
+}
+
+// Compares the counts of both matchers over values, inbound and outbound alike, and returns
+// the entries matched as literals
+static std::size_t CompareList(std::mt19937& random, std::size_t count, std::size_t value_count)
+{
+	// Every regex and not_regex entry went through an unanchored case-insensitive RE2 set
+	Matcher<std::size_t> reference(false, false, RE2::UNANCHORED);
+	Matcher<std::size_t> not_reference(false, false, RE2::UNANCHORED);
+	std::vector<std::size_t> not_indexes;
+	DomainSets domain_sets;
+	GlobalStringMatcher matcher(domain_sets);
+	PatternErrors<std::size_t> errors;
+
+	std::vector<Regex> regexes;
+	for (std::size_t i = 0; i < count; i++)
+	{
+		regexes.push_back(RandomRegex(random));
+		const std::string& pattern = regexes.back().pattern;
+		if (random() % 4)
+		{
+			reference.Add(pattern, i, errors);
+			matcher.Add(GlobalList::MatchType::REGEX, pattern, i, errors);
+		}
+		else
+		{
+			not_reference.Add(pattern, i, errors);
+			not_indexes.push_back(i);
+			matcher.Add(GlobalList::MatchType::NOT_REGEX, pattern, i, errors);
+		}
+	}
+	reference.Compile(errors);
+	not_reference.Compile(errors);
+	for (auto* engine : matcher.GetMatchers())
+	{
+		engine->Compile(errors);
+	}
+	Check(errors.empty(), "Regex patterns reported errors");
+	Check(matcher.GetPatternCount() == count, "GlobalStringMatcher lost patterns");
+
+	GlobalList::Counters expected(count, GlobalList::Counter{0, 0}), found = expected;
+	GlobalList::Counter evaluated{0, 0}, matcher_evaluated{0, 0};
+	MatchScratch<std::size_t> scratch;
+	std::vector<std::size_t> indexes;
+	for (std::size_t i = 0; i < value_count; i++)
+	{
+		std::string value = random() % 2 ? Test::Variant(random, regexes[random() % regexes.size()].sample, true)
+		                                 : Test::RandomText(random, 12);
+		// ^ and $ don't match around a newline, .* doesn't cross one
+		if (random() % 8 == 0)
+			value.insert(random() % (value.size() + 1), "\n");
+		const bool inbound = random() % 2;
+
+		reference.Match(value, indexes, scratch);
+		GlobalList::Count(inbound, false, indexes, expected);
+		not_reference.Match(value, indexes, scratch);
+		GlobalList::Count(inbound, true, indexes, expected);
+		(inbound) ? evaluated.inbound++ : evaluated.outbound++;
+
+		matcher.Match(inbound, value, found, matcher_evaluated, scratch);
+	}
+	GlobalList::Finalize(evaluated, not_indexes, expected);
+	matcher.Finalize(matcher_evaluated, found);
+
+	for (std::size_t i = 0; i < count; i++)
+	{
+		Check(found[i].inbound == expected[i].inbound && found[i].outbound == expected[i].outbound,
+		      "GlobalStringMatcher counts differ from the reference for [" + regexes[i].pattern + "]");
+	}
+	return matcher.GetDemotedCount();
+}
+
+int main()
+{
+	// The forms which are literals and those which only look like one
+	const std::pair<std::string, RegexLiteral::Form> forms[] = {
+		{"^user@example\\.com$", RegexLiteral::Form::EXACT},
+		{"^mail\\.", RegexLiteral::Form::PREFIX},
+		{"\\.example\\.com$", RegexLiteral::Form::SUFFIX},
+		{".*bob.*", RegexLiteral::Form::SUBSTRING},
+		{"a\\+b", RegexLiteral::Form::SUBSTRING},
+		{"cost\\$", RegexLiteral::Form::SUBSTRING},
+		{"dir\\\\$", RegexLiteral::Form::SUFFIX},
+		{"\\.*", RegexLiteral::Form::NONE},
+		{".*", RegexLiteral::Form::NONE},
+		{"^$", RegexLiteral::Form::NONE},
+		{"a.b", RegexLiteral::Form::NONE},
+		{"\\d+", RegexLiteral::Form::NONE},
+		{"\\x41", RegexLiteral::Form::NONE},
+		{"(?i)abc", RegexLiteral::Form::NONE},
+		{"\xE2\x84\xAA" "elvin", RegexLiteral::Form::NONE},
+		{"\xC5\xBF" "ender", RegexLiteral::Form::NONE}
+	};
+	for (const auto& [pattern, form] : forms)
+	{
+		Check(RegexLiteral::Parse(pattern).form == form, "RegexLiteral read [" + pattern + "] as the wrong form");
+	}
+	Check(RegexLiteral::Parse("^user@example\\.com$").literal == "user@example.com", "RegexLiteral unescaped wrong");
+
+	std::mt19937 random(23);
+	std::size_t demoted = 0, count = 0;
+	for (int round = 0; round < 50; round++)
+	{
+		const std::size_t patterns = 1 + random() % 100;
+		demoted += CompareList(random, patterns, 500);
+		count += patterns;
+	}
+	Check(demoted && demoted < count, "The random entries didn't go to both the literal engines and RE2");
+
+	return Test::Result("GlobalStringMatcherTest");
+}
@@ -0,0 +1,59 @@
+/**
+ * This code was tested against C++20
+ *
+ * @author Ludvik Jerabek
+ * @package slanalyzer
+ * @version 1.0.0
+ * @license MIT
+ */
+#include "MatcherCheck.h"
+#include "HashMatcher.h"
+#include "Matcher.h"
+
+using namespace Proofpoint;
+using Proofpoint::Test::Check;
+
+int main()
+{
+	// Nothing to find before Compile, nor in an empty list
+	{
+		HashMatcher<std::size_t> hash;
+		PatternErrors<std::size_t> errors;
+		MatchScratch<std::size_t> scratch;
+		std::vector<std::size_t> found;
+		Check(!hash.Match("a", found, scratch) && found.empty(), "HashMatcher matched an empty list");
+		hash.Add("a", 0, errors);
+		Check(!hash.Match("a", found, scratch) && found.empty(), "HashMatcher matched before Compile");
+	}
+
+	std::mt19937 random(6);
+	for (int round = 0; round < 50; round++)
+	{
+		// The equal entries went through an anchored case-insensitive literal RE2 set
+		Matcher<std::size_t> reference(true, false, RE2::ANCHOR_BOTH);
+		HashMatcher<std::size_t> hash;
+		PatternErrors<std::size_t> errors;
+
+		std::vector<std::string> patterns;
+		for (std::size_t i = 0, count = 1 + random() % 200; i < count; i++)
+		{
+			// Repeats add several entries for one key
+			patterns.push_back(i && random() % 8 == 0 ? patterns[random() % i] : Test::RandomText(random, 6));
+			reference.Add(patterns.back(), i, errors);
+			hash.Add(patterns.back(), i, errors);
+		}
+		reference.Compile(errors);
+		hash.Compile(errors);
+		Check(errors.empty(), "Literal patterns reported errors");
+
+		std::vector<std::string> values;
+		for (int i = 0; i < 500; i++)
+		{
+			values.push_back(random() % 2 ? Test::Variant(random, patterns[random() % patterns.size()], false)
+			                              : Test::RandomText(random, 6));
+		}
+		Test::CompareMatchers("HashMatcher", reference, hash, values);
+	}
+
+	return Test::Result("HashMatcherTest");
+}
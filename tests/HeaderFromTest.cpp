@@ -0,0 +1,69 @@
+/**
+ * This code was tested against C++20
+ *
+ * @author Ludvik Jerabek
+ * @package slanalyzer
+ * @version 1.0.0
+ * @license MIT
+ */
+#include "Check.h"
+#include "HeaderFrom.h"
+#include "re2/re2.h"
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Proofpoint;
+using Proofpoint::Test::Check;
+
+// Address characters, the delimiters around an address and the bytes of ’ on their own
+static const std::vector<std::string> PIECES = {
+	"a", "Z", "0", "-", ".", "!", "+", "~", "_", "@", "@", " ", "\t", "\n", "\v",
+	"<", ">", ";", ",", "\"", "’", "é", "\xE2", "\x80\x99", "user", "example.com"
+};
+
+// The first group of the regex Extract replaced, the value when it doesn't match
+static std::string_view Reference(const RE2& regex, std::string_view value)
+{
+	re2::StringPiece groups[2];
+	if (!regex.Match(value, 0, value.size(), RE2::UNANCHORED, groups, 2))
+		return value;
+	return {groups[1].data(), groups[1].size()};
+}
+
+static void Compare(const RE2& regex, const HeaderFrom& hfrom, const std::string& value)
+{
+	const std::string_view expected = Reference(regex, value);
+	const std::string_view found = hfrom.Extract(value);
+	// The same characters of value, not just equal text
+	Check(found.data() == expected.data() && found.size() == expected.size(),
+	      "HeaderFrom differs from the regex on [" + value + "], [" + std::string(found) + "] instead of [" +
+	      std::string(expected) + "]");
+}
+
+int main()
+{
+	const RE2 regex(R"(<?\s*([a-zA-Z0-9.!#$%&’*+\/=?^_`{|}~-]+@[a-zA-Z0-9-]+(?:\.[a-zA-Z0-9-]+)*)\s*>?\s*(?:;|$))");
+	const HeaderFrom hfrom;
+
+	for (const std::string value : {"", "@", "user@example.com", "Name <user@example.com>", "<user@example.com>;",
+	                                "a@b; c@d", "first@a.b second@c.d", "o’brien@example.com", "@example.com",
+	                                "user@", "user@example.", "user@.com", "user@example.com >x"})
+	{
+		Compare(regex, hfrom, value);
+	}
+
+	std::mt19937 random(20);
+	std::string value;
+	for (int i = 0; i < 200000; i++)
+	{
+		value.clear();
+		for (std::size_t n = random() % 16; n; n--)
+		{
+			value += PIECES[random() % PIECES.size()];
+		}
+		Compare(regex, hfrom, value);
+	}
+
+	return Test::Result("HeaderFromTest");
+}
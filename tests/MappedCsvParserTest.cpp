@@ -0,0 +1,89 @@
+/**
+ * This code was tested against C++20
+ *
+ * @author Ludvik Jerabek
+ * @package slanalyzer
+ * @version 1.0.0
+ * @license MIT
+ */
+#include "Check.h"
+#include "CsvParser.h"
+#include "MappedCsvParser.h"
+#include <random>
+#include <sstream>
+
+using Proofpoint::Test::Check;
+using Rows = std::vector<std::vector<std::string>>;
+
+// Rows as the original istream parser reads them, the reference for every other reader
+static Rows ReadCsvParser(const std::string& input)
+{
+	std::istringstream stream(input);
+	csv::CsvParser parser(stream);
+	Rows rows;
+	for (const auto& row : parser)
+	{
+		rows.push_back(row);
+	}
+	return rows;
+}
+
+static Rows ReadMapped(const std::string& input)
+{
+	csv::MappedCsvParser parser{std::string_view(input)};
+	std::vector<std::string_view> row;
+	std::deque<std::string> unescaped;
+	Rows rows;
+	while (parser.next_row(row, unescaped))
+	{
+		rows.emplace_back(row.begin(), row.end());
+	}
+	return rows;
+}
+
+// Printable form of an input for failure messages
+static std::string Escape(const std::string& input)
+{
+	std::string escaped;
+	for (char c : input.substr(0, 200))
+	{
+		escaped += c == '\n' ? "\\n" : c == '\r' ? "\\r" : std::string(1, c);
+	}
+	return escaped;
+}
+
+static void Compare(const std::string& input)
+{
+	Check(ReadMapped(input) == ReadCsvParser(input), "MappedCsvParser differs from CsvParser on [" + Escape(input) + "]");
+}
+
+int main()
+{
+	// Quoting, terminators and empty fields the state machine distinguishes
+	for (const std::string input : {
+		     "", "a", "a,b\n", "a,b", "a,b,\n", "a,b,", ",\n", ",,\n,,", "\n", "\n\n", "a\r\nb\r\n", "a\rb\r",
+		     "a\n\nb\n", "\"a,b\",c\n", "\"a\"\"b\",c\n", "\"\"\n", "\"a\nb\",c\r\n", "\"a\rb\"", "a\"b,c\n",
+		     "\"a\"b,c\n", "\"unterminated,a\nb", "\"\"\"\",\"\"\n", " \"a\" ,b\n", "h1,h2\nv1,\"v\n2\"\nv3,v4"
+	     })
+	{
+		Compare(input);
+	}
+
+	// Fields longer than a chunk of the structural index
+	Compare(std::string(100000, 'x') + ",y\n\"" + std::string(70000, ',') + "\"\n" + std::string(40000, '"'));
+
+	// Random inputs over the characters which drive the state machine
+	std::mt19937 random(20240601);
+	const std::string alphabet = "ab,,\"\"\n\r ";
+	for (int i = 0; i < 20000; i++)
+	{
+		std::string input(random() % 64, ' ');
+		for (char& c : input)
+		{
+			c = alphabet[random() % alphabet.size()];
+		}
+		Compare(input);
+	}
+
+	return Proofpoint::Test::Result("MappedCsvParserTest");
+}
@@ -0,0 +1,89 @@
+/**
+ * This code was tested against C++20
+ *
+ * @author Ludvik Jerabek
+ * @package slanalyzer
+ * @version 1.0.0
+ * @license MIT
+ */
+#ifndef SLANALYZER_MATCHERCHECK_H
+#define SLANALYZER_MATCHERCHECK_H
+
+#include "Check.h"
+#include "IMatcher.h"
+#include "Utils.h"
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace Proofpoint::Test
+{
+	// Pieces patterns and values are made of: mixed case ASCII, address punctuation and the
+	// non-ASCII characters RE2 folds onto ASCII letters, the Kelvin sign onto k and the long
+	// s onto s, or onto other non-ASCII ones, É onto é
+	inline const std::vector<std::string> PIECES = {
+		"a", "b", "k", "s", "A", "B", "K", "S", "0", "1", ".", "@", "-", "_", " ",
+		"K", "ſ", "é", "É", "ß"
+	};
+
+	inline std::string RandomText(std::mt19937& random, std::size_t max_pieces)
+	{
+		std::string text;
+		for (std::size_t n = random() % (max_pieces + 1); n; n--)
+		{
+			text += PIECES[random() % PIECES.size()];
+		}
+		return text;
+	}
+
+	// A pattern as a value, some letters in the other case or spelled with the non-ASCII
+	// characters folding onto them, sometimes with text around it
+	inline std::string Variant(std::mt19937& random, const std::string& pattern, bool around)
+	{
+		std::string value;
+		for (char c : pattern)
+		{
+			const char lower = Utils::ascii_lower(c);
+			if (random() % 3)
+				value += c;
+			else if (lower == 'k' && random() % 2)
+				value += "K";
+			else if (lower == 's' && random() % 2)
+				value += "ſ";
+			else
+				value += (c >= 'a' && c <= 'z') ? static_cast<char>(c - ('a' - 'A')) : lower;
+		}
+		if (around && random() % 2)
+		{
+			value = RandomText(random, 3) + value + RandomText(random, 3);
+		}
+		return value;
+	}
+
+	// Requires engine to report the entries reference does for every value, through Match and
+	// through MatchAscii for the ASCII ones as the Global matchers call it
+	template <typename Reference, typename Engine>
+	void CompareMatchers(const std::string& name, const Reference& reference, const Engine& engine,
+	                     const std::vector<std::string>& values)
+	{
+		MatchScratch<std::size_t> scratch;
+		std::vector<std::size_t> expected, found;
+		std::string lower;
+		for (const auto& value : values)
+		{
+			reference.Match(value, expected, scratch);
+			std::sort(expected.begin(), expected.end());
+
+			engine.Match(value, found, scratch);
+			std::sort(found.begin(), found.end());
+			Check(found == expected, name + " Match differs from the reference on [" + value + "]");
+
+			const bool ascii = Utils::ascii_lower_copy(value, lower);
+			MatchValue(engine, value, ascii, lower, found, scratch);
+			std::sort(found.begin(), found.end());
+			Check(found == expected, name + " MatchAscii differs from the reference on [" + value + "]");
+		}
+	}
+}
+#endif //SLANALYZER_MATCHERCHECK_H
@@ -0,0 +1,105 @@
+/**
+ * This code was tested against C++20
+ *
+ * @author Ludvik Jerabek
+ * @package slanalyzer
+ * @version 1.0.0
+ * @license MIT
+ */
+#include "Check.h"
+#include "CsvParser.h"
+#include "ParallelCsvParser.h"
+#include <sstream>
+
+using Proofpoint::Test::Check;
+
+// Rows joined into one string each, fields separated by \x1f, to keep a 48 MB input cheap
+static std::string Join(const auto& row)
+{
+	std::string joined;
+	for (const auto& field : row)
+	{
+		joined.append(field.data(), field.size());
+		joined += '\x1f';
+	}
+	return joined;
+}
+
+static std::vector<std::string> ReadCsvParser(const std::string& input)
+{
+	std::istringstream stream(input);
+	csv::CsvParser parser(stream);
+	std::vector<std::string> rows;
+	for (const auto& row : parser)
+	{
+		rows.push_back(Join(row));
+	}
+	return rows;
+}
+
+static std::vector<std::string> ReadParallel(const std::string& input, std::size_t threads)
+{
+	csv::ParallelCsvParser parser(input, 0, threads);
+	std::vector<std::vector<std::string>> worker_rows(parser.workers());
+	parser.Run([&](std::size_t worker, const auto& row) { worker_rows[worker].push_back(Join(row)); },
+	           [&](std::size_t worker) { worker_rows[worker].clear(); });
+
+	std::vector<std::string> rows;
+	for (auto& worker : worker_rows)
+	{
+		rows.insert(rows.end(), std::make_move_iterator(worker.begin()), std::make_move_iterator(worker.end()));
+	}
+	return rows;
+}
+
+// Rows of filler up to exactly three chunks, field is written so it starts just ahead of
+// each chunk boundary and the boundary falls inside it
+static std::string Input(const std::string& field)
+{
+	constexpr std::size_t CHUNK = csv::ParallelCsvParser::MIN_CHUNK_SIZE;
+	const std::string filler = "user@example.com,sender@example.net,\"Subject, with a comma\",default_inbound\n";
+
+	std::string input = "Recipients,Sender,Subject,Policy_Route\n";
+	input.reserve(3 * CHUNK);
+	for (std::size_t boundary = CHUNK; boundary < 3 * CHUNK; boundary += CHUNK)
+	{
+		while (input.size() + filler.size() < boundary - field.size() / 2)
+		{
+			input += filler;
+		}
+		input += "a@example.com,b@example.com," + field + ",x\n";
+	}
+	while (input.size() + filler.size() < 3 * CHUNK)
+	{
+		input += filler;
+	}
+	input.append(3 * CHUNK - input.size() - 1, 'z');
+	input += '\n';
+	return input;
+}
+
+int main()
+{
+	// Every worker's range has to start on the row a reader from the beginning would see
+	// there, quoted terminators and delimiters across the boundary included
+	const std::vector<std::pair<std::string, std::string>> cases = {
+		{"quoted newlines", "\"" + std::string(200, 'q') + "\n\r\n,\n" + std::string(200, 'q') + "\""},
+		{"quoted rows", "\"line one\na,b,c,d\n\"\"escaped\"\"\nx,y\n" + std::string(300, 'r') + "\""},
+		// The odd quote count sends the next worker's speculative start into the quoted field
+		// behind it, the worker has to be reset and parse again
+		{"stray quote", "ab\"" + std::string(400, 's') + ",\"quoted\nnewline\",more"},
+	};
+
+	for (const auto& [name, field] : cases)
+	{
+		const std::string input = Input(field);
+		const std::vector<std::string> expected = ReadCsvParser(input);
+		for (std::size_t threads : {1, 2, 3, 4})
+		{
+			Check(ReadParallel(input, threads) == expected,
+			      "ParallelCsvParser with " + std::to_string(threads) + " threads differs from CsvParser, " + name);
+		}
+	}
+
+	return Proofpoint::Test::Result("ParallelCsvParserTest");
+}
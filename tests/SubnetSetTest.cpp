@@ -0,0 +1,212 @@
+/**
+ * This code was tested against C++20
+ *
+ * @author Ludvik Jerabek
+ * @package slanalyzer
+ * @version 1.0.0
+ * @license MIT
+ */
+#include "Check.h"
+#include "SubnetSet.h"
+#include <algorithm>
+#include <random>
+
+using namespace Proofpoint;
+using Proofpoint::Test::Check;
+
+// Network and mask of a CIDR as added
+struct Cidr4
+{
+	uint32_t network;
+	uint32_t mask;
+};
+
+struct Cidr6
+{
+	Address6 network;
+	Address6 mask;
+};
+
+static uint32_t Mask4(unsigned bits)
+{
+	return bits ? 0xFFFFFFFFu << (32 - bits) : 0;
+}
+
+static Address6 Mask6(unsigned bits)
+{
+	const auto half = [](unsigned n) { return n ? ~0ull << (64 - std::min(n, 64u)) : 0ull; };
+	return {half(bits), half(bits > 64 ? bits - 64 : 0)};
+}
+
+// Tests an address against every CIDR
+struct Reference
+{
+	std::vector<std::pair<Cidr4, int>> v4;
+	std::vector<std::pair<Cidr6, int>> v6;
+
+	std::vector<int> Match(uint32_t ip) const
+	{
+		std::vector<int> ids;
+		for (const auto& [cidr, id] : v4)
+		{
+			if (((ip ^ cidr.network) & cidr.mask) == 0)
+				ids.push_back(id);
+		}
+		return ids;
+	}
+
+	std::vector<int> Match(const Address6& ip) const
+	{
+		std::vector<int> ids;
+		for (const auto& [cidr, id] : v6)
+		{
+			if ((((ip.hi ^ cidr.network.hi) & cidr.mask.hi) | ((ip.lo ^ cidr.network.lo) & cidr.mask.lo)) == 0)
+				ids.push_back(id);
+		}
+		return ids;
+	}
+};
+
+// Addresses and CIDRs cluster around a few networks so that CIDRs nest and overlap
+static uint32_t RandomAddress4(std::mt19937& random)
+{
+	static const uint32_t bases[] = {0x0A000000u, 0xC0A80000u, 0xAC100000u, 0x00000000u, 0xFFFFFF00u};
+	switch (random() % 3)
+	{
+	case 0: return random();
+	default: return bases[random() % std::size(bases)] | (random() & Mask4(random() % 33) >> (random() % 24));
+	}
+}
+
+static Address6 RandomAddress6(std::mt19937& random)
+{
+	static const Address6 bases[] = {{0x20010DB800000000ull, 0}, {0, 0x0000FFFF00000000ull}, {0xFE80000000000000ull, 0}};
+	const auto wide = [&random] { return (static_cast<uint64_t>(random()) << 32) | random(); };
+	if (random() % 4 == 0)
+		return {wide(), wide()};
+	const Address6 base = bases[random() % std::size(bases)];
+	return {base.hi | (wide() >> (32 + random() % 32)), base.lo | (wide() >> (32 + random() % 33))};
+}
+
+// Compares every lookup of the three layouts with the reference for count random CIDRs
+static void CompareSets(std::mt19937& random, std::size_t count)
+{
+	const SubnetSet::Layout layouts[] = {SubnetSet::Layout::TRIE, SubnetSet::Layout::DIR_24_8,
+	                                     SubnetSet::Layout::POPTRIE};
+	std::vector<SubnetSet> sets(std::size(layouts));
+	Reference reference;
+	std::vector<uint32_t> addresses4;
+	std::vector<Address6> addresses6;
+
+	for (std::size_t i = 0; i < count; i++)
+	{
+		std::string cidr;
+		if (random() % 4 == 0)
+		{
+			const unsigned bits = random() % 129;
+			const Address6 mask = Mask6(bits);
+			const Address6 address = RandomAddress6(random);
+			reference.v6.push_back({{{address.hi & mask.hi, address.lo & mask.lo}, mask}, static_cast<int>(i)});
+			cidr = Subnet6::GetAddress(address) + "/" + std::to_string(bits);
+			// Its first and last addresses
+			addresses6.push_back({address.hi & mask.hi, address.lo & mask.lo});
+			addresses6.push_back({address.hi | ~mask.hi, address.lo | ~mask.lo});
+		}
+		else
+		{
+			const unsigned bits = random() % 4 ? 8 + random() % 25 : random() % 33;
+			const uint32_t mask = Mask4(bits);
+			const uint32_t address = RandomAddress4(random);
+			reference.v4.push_back({{address & mask, mask}, static_cast<int>(i)});
+			cidr = Subnet::GetAddress(address, Subnet::HOST) + "/" + std::to_string(bits);
+			// Its first and last addresses and their neighbours
+			for (uint32_t edge : {address & mask, address | ~mask})
+			{
+				addresses4.insert(addresses4.end(), {edge - 1, edge, edge + 1});
+			}
+		}
+
+		for (auto& set : sets)
+		{
+			std::string error;
+			Check(set.Add(cidr, &error) == static_cast<int>(i) && error.empty(), "SubnetSet rejected " + cidr);
+		}
+	}
+	for (std::size_t i = 0; i < sets.size(); i++)
+	{
+		sets[i].Freeze(layouts[i]);
+	}
+
+	for (int i = 0; i < 2000; i++)
+	{
+		addresses4.push_back(RandomAddress4(random));
+		addresses6.push_back(RandomAddress6(random));
+	}
+	addresses4.insert(addresses4.end(), {0u, 0xFFFFFFFFu});
+
+	std::vector<int> found;
+	std::vector<uint32_t> offsets;
+	std::vector<int> ids;
+	for (std::size_t l = 0; l < sets.size(); l++)
+	{
+		const SubnetSet& set = sets[l];
+		const std::string& layout = SubnetSet::GetLayoutString(layouts[l]);
+		for (uint32_t address : addresses4)
+		{
+			const std::vector<int> expected = reference.Match(address);
+			const std::string text = Subnet::GetAddress(address, Subnet::HOST);
+
+			const bool matched = set.Match(address, &found);
+			std::sort(found.begin(), found.end());
+			Check(matched == !expected.empty() && found == expected, layout + " differs from the reference on " + text);
+			set.Match(text, &found);
+			std::sort(found.begin(), found.end());
+			Check(found == expected, layout + " differs from the reference on the text " + text);
+
+			// An IPv4 mapped address matches the IPv4 CIDRs and the IPv6 ones containing it
+			std::vector<int> mapped = reference.Match(Address6{0, 0x0000FFFF00000000ull | address});
+			mapped.insert(mapped.end(), expected.begin(), expected.end());
+			std::sort(mapped.begin(), mapped.end());
+			set.Match("::ffff:" + text, &found);
+			std::sort(found.begin(), found.end());
+			Check(found == mapped, layout + " differs from the reference on ::ffff:" + text);
+		}
+
+		for (const Address6& address : addresses6)
+		{
+			const std::vector<int> expected = reference.Match(address);
+			set.Match(address, &found);
+			std::sort(found.begin(), found.end());
+			Check(found == expected, layout + " differs from the reference on " + Subnet6::GetAddress(address));
+		}
+
+		set.MatchBatch(addresses4, offsets, ids);
+		Check(offsets.size() == addresses4.size() + 1, layout + " MatchBatch returned the wrong number of offsets");
+		for (std::size_t i = 0; i + 1 < offsets.size(); i++)
+		{
+			found.assign(ids.begin() + offsets[i], ids.begin() + offsets[i + 1]);
+			std::sort(found.begin(), found.end());
+			Check(found == reference.Match(addresses4[i]),
+			      layout + " MatchBatch differs from the reference on " + Subnet::GetAddress(addresses4[i], Subnet::HOST));
+		}
+	}
+}
+
+int main()
+{
+	// Nothing matches an empty set
+	{
+		SubnetSet set;
+		std::vector<int> found;
+		set.Freeze(SubnetSet::Layout::POPTRIE);
+		Check(!set.Match("10.0.0.1", &found) && found.empty(), "An empty SubnetSet matched");
+	}
+
+	std::mt19937 random(14);
+	for (std::size_t count : {1, 2, 5, 20, 100, 500, 2000})
+	{
+		CompareSets(random, count);
+	}
+
+	return Test::Result("SubnetSetTest");
+}